@@ -0,0 +1,184 @@
+// 反射生成的二进制编解码 vs 手写编解码
+// g++ -std=c++20 -O2 bench_binary_codec.cpp -o bench_binary_codec
+// 目标: 反射版本与手写版本的耗时差距在10%以内
+// 另外测一批订单(vector<Order>，symbol超出SSO长度)反复解码到同一个对象时的耗时和堆分配次数
+#include "binary_codec.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+static std::atomic<size_t> g_allocations{0};
+
+void *operator new(size_t n)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(n ? n : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+struct Order
+{
+    ENABLE_REFLECT(Order)
+    REFLECTABLE(Order, uint64_t, id)
+    REFLECTABLE(Order, uint32_t, account)
+    REFLECTABLE(Order, int32_t, quantity)
+    REFLECTABLE(Order, double, price)
+    REFLECTABLE(Order, double, stop_price)
+    REFLECTABLE(Order, uint8_t, side)
+    REFLECTABLE(Order, bool, is_limit)
+    REFLECTABLE(Order, std::string, symbol)
+    REFLECTABLE(Order, int64_t, timestamp)
+};
+
+struct OrderBatch
+{
+    ENABLE_REFLECT(OrderBatch)
+    REFLECTABLE(OrderBatch, std::vector<Order>, orders)
+};
+
+// 手写版本，线上格式与kFixed一致
+static void handEncode(const Order &o, reflection::OutputBuffer &out)
+{
+    out.append(&o.id, sizeof(o.id));
+    out.append(&o.account, sizeof(o.account));
+    out.append(&o.quantity, sizeof(o.quantity));
+    out.append(&o.price, sizeof(o.price));
+    out.append(&o.stop_price, sizeof(o.stop_price));
+    out.append(&o.side, sizeof(o.side));
+    out.append(&o.is_limit, sizeof(o.is_limit));
+    reflection::binary::details::appendVarint(out, o.symbol.size());
+    out.append(o.symbol.data(), o.symbol.size());
+    out.append(&o.timestamp, sizeof(o.timestamp));
+}
+
+static bool handDecode(std::string_view input, Order &o)
+{
+    reflection::binary::Reader in(input);
+    in.read(&o.id, sizeof(o.id));
+    in.read(&o.account, sizeof(o.account));
+    in.read(&o.quantity, sizeof(o.quantity));
+    in.read(&o.price, sizeof(o.price));
+    in.read(&o.stop_price, sizeof(o.stop_price));
+    in.read(&o.side, sizeof(o.side));
+    in.read(&o.is_limit, sizeof(o.is_limit));
+    uint64_t n = 0;
+    std::string_view symbol;
+    if (in.readVarint(n) && in.take(n, symbol))
+    {
+        o.symbol.assign(symbol);
+    }
+    in.read(&o.timestamp, sizeof(o.timestamp));
+    return in.ok && in.remaining() == 0;
+}
+
+template <typename T>
+static void doNotOptimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+template <typename F>
+static double nsPerOp(size_t iterations, F &&f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        f(i);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+int main()
+{
+    constexpr size_t kIterations = 20'000'000;
+    Order order{};
+    order.id = 123456789;
+    order.account = 42;
+    order.quantity = -300;
+    order.price = 101.25;
+    order.stop_price = 99.5;
+    order.side = 1;
+    order.is_limit = true;
+    order.symbol = "AAPL";
+    order.timestamp = 1700000000000;
+
+    reflection::OutputBuffer buffer;
+    Order decoded{};
+
+    double handEnc = nsPerOp(kIterations, [&](size_t i)
+                             {
+        buffer.clear();
+        order.id = i;
+        handEncode(order, buffer);
+        doNotOptimize(buffer.data()); });
+    double reflEnc = nsPerOp(kIterations, [&](size_t i)
+                             {
+        buffer.clear();
+        order.id = i;
+        reflection::binary::encode(order, buffer);
+        doNotOptimize(buffer.data()); });
+
+    std::string wire = buffer.str();
+    buffer.clear();
+    handEncode(order, buffer);
+    if (buffer.view() != wire)
+    {
+        std::printf("wire format mismatch\n");
+        return 1;
+    }
+
+    double handDec = nsPerOp(kIterations, [&](size_t)
+                             {
+        handDecode(wire, decoded);
+        doNotOptimize(decoded); });
+    double reflDec = nsPerOp(kIterations, [&](size_t)
+                             {
+        reflection::binary::decode(wire, decoded);
+        doNotOptimize(decoded); });
+
+    buffer.clear();
+    reflection::binary::encode<reflection::binary::kZigZag>(order, buffer);
+    size_t zigzagSize = buffer.size();
+    double zigzagEnc = nsPerOp(kIterations, [&](size_t i)
+                               {
+        buffer.clear();
+        order.id = i;
+        reflection::binary::encode<reflection::binary::kZigZag>(order, buffer);
+        doNotOptimize(buffer.data()); });
+
+    constexpr size_t kBatchIterations = kIterations / 64;
+    OrderBatch batch;
+    for (size_t i = 0; i < 64; ++i)
+    {
+        batch.orders.push_back(order);
+        batch.orders.back().id = i;
+        batch.orders.back().symbol = "NASDAQ:AAPL 2026-01-16 C 150.00 #" + std::to_string(i);
+    }
+    buffer.clear();
+    reflection::binary::encode(batch, buffer);
+    std::string batchWire = buffer.str();
+    OrderBatch decodedBatch;
+    reflection::binary::decode(batchWire, decodedBatch);
+    size_t allocationsBefore = g_allocations.load();
+    double batchDec = nsPerOp(kBatchIterations, [&](size_t)
+                              {
+        reflection::binary::decode(batchWire, decodedBatch);
+        doNotOptimize(decodedBatch); });
+    double batchAllocs = static_cast<double>(g_allocations.load() - allocationsBefore) / kBatchIterations;
+
+    std::printf("message size: fixed %zu bytes, zigzag varint %zu bytes\n", wire.size(), zigzagSize);
+    std::printf("encode: hand %.2f ns  reflect %.2f ns  (%+.1f%%)\n", handEnc, reflEnc, (reflEnc / handEnc - 1) * 100);
+    std::printf("decode: hand %.2f ns  reflect %.2f ns  (%+.1f%%)\n", handDec, reflDec, (reflDec / handDec - 1) * 100);
+    std::printf("encode zigzag varint: %.2f ns\n", zigzagEnc);
+    std::printf("decode batch of %zu into reused object: %.2f ns  %.2f allocs\n", batch.orders.size(), batchDec, batchAllocs);
+    return 0;
+}
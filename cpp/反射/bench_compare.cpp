@@ -0,0 +1,179 @@
+// reflection::hash/equal 作为unordered_map键的查找耗时，对照组为手写的std::hash特化和operator==
+// g++ -std=c++20 -O2 bench_compare.cpp -o bench_compare
+#include "compare.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <unordered_map>
+
+// 没有填充、全是整数: 走整块memcmp和整块哈希
+struct CacheKey
+{
+    ENABLE_REFLECT(CacheKey)
+    REFLECTABLE(CacheKey, uint64_t, tenant)
+    REFLECTABLE(CacheKey, uint32_t, region)
+    REFLECTABLE(CacheKey, uint32_t, shard)
+    REFLECTABLE(CacheKey, uint64_t, object)
+    REFLECTABLE(CacheKey, uint32_t, version)
+    REFLECTABLE(CacheKey, uint32_t, flags)
+
+    bool operator==(const CacheKey &o) const
+    {
+        return tenant == o.tenant && region == o.region && shard == o.shard && object == o.object &&
+               version == o.version && flags == o.flags;
+    }
+};
+
+// 含字符串: 逐成员展开
+struct RouteKey
+{
+    ENABLE_REFLECT(RouteKey)
+    REFLECTABLE(RouteKey, std::string, service)
+    REFLECTABLE(RouteKey, std::string, method)
+    REFLECTABLE(RouteKey, int, version)
+    REFLECTABLE(RouteKey, bool, canary)
+
+    bool operator==(const RouteKey &o) const
+    {
+        return service == o.service && method == o.method && version == o.version && canary == o.canary;
+    }
+};
+
+static_assert(reflection::details::isBitwiseComparable<CacheKey>());
+static_assert(!reflection::details::isBitwiseComparable<RouteKey>());
+
+// 常见的手写方式: 每个成员std::hash再hash_combine
+inline void hashCombine(size_t &seed, size_t value)
+{
+    seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+}
+
+template <>
+struct std::hash<CacheKey>
+{
+    size_t operator()(const CacheKey &k) const
+    {
+        size_t seed = 0;
+        hashCombine(seed, std::hash<uint64_t>{}(k.tenant));
+        hashCombine(seed, std::hash<uint32_t>{}(k.region));
+        hashCombine(seed, std::hash<uint32_t>{}(k.shard));
+        hashCombine(seed, std::hash<uint64_t>{}(k.object));
+        hashCombine(seed, std::hash<uint32_t>{}(k.version));
+        hashCombine(seed, std::hash<uint32_t>{}(k.flags));
+        return seed;
+    }
+};
+
+template <>
+struct std::hash<RouteKey>
+{
+    size_t operator()(const RouteKey &k) const
+    {
+        size_t seed = 0;
+        hashCombine(seed, std::hash<std::string>{}(k.service));
+        hashCombine(seed, std::hash<std::string>{}(k.method));
+        hashCombine(seed, std::hash<int>{}(k.version));
+        hashCombine(seed, std::hash<bool>{}(k.canary));
+        return seed;
+    }
+};
+
+// 只算哈希，排除哈希表本身的缓存缺失
+template <typename Hash, typename Key>
+static void hashOnly(const char *label, const std::vector<Key> &keys)
+{
+    double best = 1e30;
+    size_t sink = 0;
+    for (int round = 0; round < 5; ++round)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (const Key &k : keys)
+        {
+            sink += Hash{}(k);
+        }
+        best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / keys.size());
+    }
+    std::printf("%-36s %6.2f ns/hash  (%zx)\n", label, best, sink & 0xf);
+}
+
+template <typename Map, typename Key>
+static double lookup(const char *label, const std::vector<Key> &keys, const std::vector<Key> &probes)
+{
+    Map map;
+    map.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        map.emplace(keys[i], i);
+    }
+    double best = 1e30;
+    size_t found = 0;
+    for (int round = 0; round < 5; ++round)
+    {
+        found = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const Key &k : probes)
+        {
+            found += map.find(k) != map.end();
+        }
+        best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / probes.size());
+    }
+    std::printf("%-36s %6.1f ns/lookup  (hits %zu/%zu, buckets %zu)\n", label, best, found, probes.size(), map.bucket_count());
+    return best;
+}
+
+int main()
+{
+    constexpr size_t kKeys = 1'000'000;
+    std::mt19937_64 rng(7);
+
+    std::vector<CacheKey> cacheKeys(kKeys);
+    for (auto &k : cacheKeys)
+    {
+        k = {rng() % 64, static_cast<uint32_t>(rng() % 8), static_cast<uint32_t>(rng() % 1024), rng(), 1, 0};
+    }
+    std::vector<RouteKey> routeKeys(kKeys);
+    for (size_t i = 0; i < kKeys; ++i)
+    {
+        routeKeys[i] = {"service-" + std::to_string(i % 997), "Method" + std::to_string(i), static_cast<int>(i % 3), (i & 7) == 0};
+    }
+
+    // 一半命中一半未命中，打乱顺序
+    auto makeProbes = [&](auto keys, auto mutate)
+    {
+        for (size_t i = 0; i < keys.size(); i += 2)
+        {
+            mutate(keys[i]);
+        }
+        std::shuffle(keys.begin(), keys.end(), rng);
+        return keys;
+    };
+    auto cacheProbes = makeProbes(cacheKeys, [](CacheKey &k)
+                                  { k.flags = 1; });
+    auto routeProbes = makeProbes(routeKeys, [](RouteKey &k)
+                                  { k.canary = !k.canary; k.version += 3; });
+
+    CacheKey a = cacheKeys[0];
+    CacheKey b = a;
+    b.object += 1;
+    if (!reflection::equal(a, a) || reflection::equal(a, b) || reflection::hash(a) == reflection::hash(b) ||
+        (reflection::compare(a, b) < 0) != (a.object < b.object))
+    {
+        std::printf("sanity check failed\n");
+        return 1;
+    }
+
+    std::printf("CacheKey (%zu bytes, bitwise fast path)\n", sizeof(CacheKey));
+    hashOnly<std::hash<CacheKey>>("  hand-written std::hash", cacheKeys);
+    hashOnly<reflection::hasher>("  reflection::hasher", cacheKeys);
+    double h1 = lookup<std::unordered_map<CacheKey, size_t>>("  hand-written std::hash + ==", cacheKeys, cacheProbes);
+    double r1 = lookup<std::unordered_map<CacheKey, size_t, reflection::hasher, reflection::equal_to>>(
+        "  reflection::hasher / equal_to", cacheKeys, cacheProbes);
+    std::printf("RouteKey (%zu bytes, per-field)\n", sizeof(RouteKey));
+    hashOnly<std::hash<RouteKey>>("  hand-written std::hash", routeKeys);
+    hashOnly<reflection::hasher>("  reflection::hasher", routeKeys);
+    double h2 = lookup<std::unordered_map<RouteKey, size_t>>("  hand-written std::hash + ==", routeKeys, routeProbes);
+    double r2 = lookup<std::unordered_map<RouteKey, size_t, reflection::hasher, reflection::equal_to>>(
+        "  reflection::hasher / equal_to", routeKeys, routeProbes);
+    std::printf("\nspeedup: CacheKey x%.2f, RouteKey x%.2f\n", h1 / r1, h2 / r2);
+    return 0;
+}
@@ -0,0 +1,125 @@
+// StructDescriptor::dump 流式输出的耗时和堆分配次数
+// g++ -std=c++20 -O2 bench_dump.cpp -o bench_dump
+// legacy为原先的实现方式(ostringstream + 每个成员返回一个std::string)，作为对照
+#include "json_writer.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+
+static std::atomic<size_t> g_allocations{0};
+
+void *operator new(size_t n)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(n ? n : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+struct Metrics
+{
+    ENABLE_REFLECT(Metrics)
+    REFLECTABLE(Metrics, int, id)
+    REFLECTABLE(Metrics, std::string, host)
+    REFLECTABLE(Metrics, std::string, region)
+    REFLECTABLE(Metrics, double, cpu)
+    REFLECTABLE(Metrics, double, memory)
+    REFLECTABLE(Metrics, long long, rx_bytes)
+    REFLECTABLE(Metrics, long long, tx_bytes)
+    REFLECTABLE(Metrics, unsigned, connections)
+    REFLECTABLE(Metrics, bool, healthy)
+    REFLECTABLE(Metrics, float, load1)
+    REFLECTABLE(Metrics, float, load5)
+    REFLECTABLE(Metrics, float, load15)
+    REFLECTABLE(Metrics, std::string, version)
+    REFLECTABLE(Metrics, int, pid)
+    REFLECTABLE(Metrics, int, threads)
+    REFLECTABLE(Metrics, double, uptime)
+    REFLECTABLE(Metrics, std::string, message)
+    REFLECTABLE(Metrics, short, priority)
+    REFLECTABLE(Metrics, char, grade)
+    REFLECTABLE(Metrics, unsigned long long, timestamp)
+};
+static_assert(reflection::member_count_v<Metrics> == 20);
+
+// 原实现的写法: 每个成员先格式化成独立的字符串再拷贝进ostringstream
+static std::string legacyDump(const reflection::StructDescriptor &desc, const void *obj)
+{
+    std::ostringstream oss;
+    oss << desc.name() << " {\n";
+    for (const auto &member : desc.getMembers())
+    {
+        oss << "  " << member.name << " = ";
+        std::string value = member.type->dump(reinterpret_cast<const char *>(obj) + member.offset);
+        oss << value << "\n";
+    }
+    oss << "}";
+    return oss.str();
+}
+
+template <typename F>
+static void run(const char *label, size_t iterations, F &&f)
+{
+    size_t before = g_allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        f();
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+    double allocs = static_cast<double>(g_allocations.load() - before) / iterations;
+    std::printf("%-28s %8.1f ns  %6.2f allocs/op\n", label, ns, allocs);
+}
+
+int main()
+{
+    constexpr size_t kIterations = 200'000;
+    Metrics m{};
+    m.id = 7;
+    m.host = "node-07.cluster.local";
+    m.region = "eu-west";
+    m.cpu = 0.734;
+    m.memory = 12.5;
+    m.rx_bytes = 123456789012;
+    m.tx_bytes = 98765432109;
+    m.connections = 1024;
+    m.healthy = true;
+    m.load1 = 1.5f;
+    m.load5 = 1.25f;
+    m.load15 = 0.75f;
+    m.version = "2.4.1";
+    m.pid = 31337;
+    m.threads = 64;
+    m.uptime = 86400.5;
+    m.message = "disk \"sda\" at 91%\n";
+    m.priority = -3;
+    m.grade = 'A';
+    m.timestamp = 1700000000123;
+
+    auto *desc = reflection::getDescriptor<Metrics>();
+    reflection::OutputBuffer out; // 复用的输出缓冲区
+
+    out.clear();
+    desc->dumpJsonTo(out, &m);
+    std::printf("%.*s\n\n", static_cast<int>(out.size()), out.data());
+
+    std::string sink;
+    run("legacy dump", kIterations, [&]
+        { sink = legacyDump(*desc, &m); });
+    run("dump (string)", kIterations, [&]
+        { sink = desc->dump(&m); });
+    run("dumpTo (reused buffer)", kIterations, [&]
+        { out.clear(); desc->dumpTo(out, &m); });
+    run("dumpJsonTo (reused buffer)", kIterations, [&]
+        { out.clear(); desc->dumpJsonTo(out, &m); });
+    run("writeJson (compile-time)", kIterations, [&]
+        { out.clear(); reflection::writeJson(out, m); });
+    return 0;
+}
@@ -0,0 +1,389 @@
+// json::Reader 解析耗时和堆分配次数
+// g++ -std=c++20 -O2 bench_json_reader.cpp -o bench_json_reader
+// 对照组是常见的写法: 先解析成通用DOM(std::map + std::variant)，再按成员名手写映射
+#include "json_reader.h"
+#include "json_writer.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <new>
+#include <variant>
+
+static std::atomic<size_t> g_allocations{0};
+
+void *operator new(size_t n)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(n ? n : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+struct Endpoint
+{
+    ENABLE_REFLECT(Endpoint)
+    REFLECTABLE(Endpoint, std::string, host)
+    REFLECTABLE(Endpoint, int, port)
+    REFLECTABLE(Endpoint, bool, tls)
+};
+
+struct Metrics
+{
+    ENABLE_REFLECT(Metrics)
+    REFLECTABLE(Metrics, int, id)
+    REFLECTABLE(Metrics, std::string, region)
+    REFLECTABLE(Metrics, double, cpu)
+    REFLECTABLE(Metrics, double, memory)
+    REFLECTABLE(Metrics, long long, rx_bytes)
+    REFLECTABLE(Metrics, long long, tx_bytes)
+    REFLECTABLE(Metrics, unsigned, connections)
+    REFLECTABLE(Metrics, bool, healthy)
+    REFLECTABLE(Metrics, float, load1)
+    REFLECTABLE(Metrics, float, load5)
+    REFLECTABLE(Metrics, float, load15)
+    REFLECTABLE(Metrics, std::string, version)
+    REFLECTABLE(Metrics, int, pid)
+    REFLECTABLE(Metrics, double, uptime)
+    REFLECTABLE(Metrics, std::string, message)
+    REFLECTABLE(Metrics, char, grade)
+    REFLECTABLE(Metrics, unsigned long long, timestamp)
+    REFLECTABLE(Metrics, Endpoint, endpoint)
+    REFLECTABLE(Metrics, std::vector<int>, latencies)
+};
+
+// ---- 对照组: 最小的通用DOM解析器 ----
+struct Value;
+using Object = std::map<std::string, Value, std::less<>>;
+using Array = std::vector<Value>;
+
+struct Value
+{
+    std::variant<std::nullptr_t, bool, double, std::string, std::unique_ptr<Array>, std::unique_ptr<Object>> v;
+};
+
+class DomParser
+{
+public:
+    explicit DomParser(std::string_view s) : _p(s.data()), _end(s.data() + s.size()) {}
+
+    bool parse(Value &out)
+    {
+        return value(out);
+    }
+
+private:
+    void ws()
+    {
+        while (_p < _end && (*_p == ' ' || *_p == '\n' || *_p == '\r' || *_p == '\t'))
+        {
+            ++_p;
+        }
+    }
+
+    bool value(Value &out)
+    {
+        ws();
+        if (_p == _end)
+        {
+            return false;
+        }
+        switch (*_p)
+        {
+        case '{':
+        {
+            auto obj = std::make_unique<Object>();
+            ++_p;
+            ws();
+            if (_p < _end && *_p == '}')
+            {
+                ++_p;
+                out.v = std::move(obj);
+                return true;
+            }
+            while (true)
+            {
+                ws();
+                std::string key;
+                if (!string(key))
+                {
+                    return false;
+                }
+                ws();
+                if (_p == _end || *_p++ != ':')
+                {
+                    return false;
+                }
+                if (!value((*obj)[std::move(key)]))
+                {
+                    return false;
+                }
+                ws();
+                if (_p == _end)
+                {
+                    return false;
+                }
+                char c = *_p++;
+                if (c == '}')
+                {
+                    break;
+                }
+                if (c != ',')
+                {
+                    return false;
+                }
+            }
+            out.v = std::move(obj);
+            return true;
+        }
+        case '[':
+        {
+            auto arr = std::make_unique<Array>();
+            ++_p;
+            ws();
+            if (_p < _end && *_p == ']')
+            {
+                ++_p;
+                out.v = std::move(arr);
+                return true;
+            }
+            while (true)
+            {
+                if (!value(arr->emplace_back()))
+                {
+                    return false;
+                }
+                ws();
+                if (_p == _end)
+                {
+                    return false;
+                }
+                char c = *_p++;
+                if (c == ']')
+                {
+                    break;
+                }
+                if (c != ',')
+                {
+                    return false;
+                }
+            }
+            out.v = std::move(arr);
+            return true;
+        }
+        case '"':
+        {
+            std::string s;
+            if (!string(s))
+            {
+                return false;
+            }
+            out.v = std::move(s);
+            return true;
+        }
+        case 't':
+            _p += 4;
+            out.v = true;
+            return true;
+        case 'f':
+            _p += 5;
+            out.v = false;
+            return true;
+        case 'n':
+            _p += 4;
+            out.v = nullptr;
+            return true;
+        default:
+        {
+            double d = 0;
+            auto result = std::from_chars(_p, _end, d);
+            if (result.ec != std::errc())
+            {
+                return false;
+            }
+            _p = result.ptr;
+            out.v = d;
+            return true;
+        }
+        }
+    }
+
+    bool string(std::string &out)
+    {
+        if (_p == _end || *_p != '"')
+        {
+            return false;
+        }
+        const char *begin = ++_p;
+        while (_p < _end && *_p != '"')
+        {
+            _p += *_p == '\\' ? 2 : 1;
+        }
+        if (_p >= _end)
+        {
+            return false;
+        }
+        bool ok = reflection::json::details::unescape(std::string_view(begin, static_cast<size_t>(_p - begin)), out);
+        ++_p;
+        return ok;
+    }
+
+    const char *_p;
+    const char *_end;
+};
+
+static const Value *find(const Object &obj, std::string_view key)
+{
+    auto it = obj.find(key);
+    return it == obj.end() ? nullptr : &it->second;
+}
+
+template <typename N>
+static void mapNumber(const Object &obj, std::string_view key, N &out)
+{
+    if (auto *v = find(obj, key); v && std::holds_alternative<double>(v->v))
+    {
+        out = static_cast<N>(std::get<double>(v->v));
+    }
+}
+
+static void mapString(const Object &obj, std::string_view key, std::string &out)
+{
+    if (auto *v = find(obj, key); v && std::holds_alternative<std::string>(v->v))
+    {
+        out = std::get<std::string>(v->v);
+    }
+}
+
+static void mapBool(const Object &obj, std::string_view key, bool &out)
+{
+    if (auto *v = find(obj, key); v && std::holds_alternative<bool>(v->v))
+    {
+        out = std::get<bool>(v->v);
+    }
+}
+
+static bool domParse(std::string_view json, Metrics &m)
+{
+    Value root;
+    if (!DomParser(json).parse(root) || !std::holds_alternative<std::unique_ptr<Object>>(root.v))
+    {
+        return false;
+    }
+    const Object &obj = *std::get<std::unique_ptr<Object>>(root.v);
+    mapNumber(obj, "id", m.id);
+    mapString(obj, "region", m.region);
+    mapNumber(obj, "cpu", m.cpu);
+    mapNumber(obj, "memory", m.memory);
+    mapNumber(obj, "rx_bytes", m.rx_bytes);
+    mapNumber(obj, "tx_bytes", m.tx_bytes);
+    mapNumber(obj, "connections", m.connections);
+    mapBool(obj, "healthy", m.healthy);
+    mapNumber(obj, "load1", m.load1);
+    mapNumber(obj, "load5", m.load5);
+    mapNumber(obj, "load15", m.load15);
+    mapString(obj, "version", m.version);
+    mapNumber(obj, "pid", m.pid);
+    mapNumber(obj, "uptime", m.uptime);
+    mapString(obj, "message", m.message);
+    if (auto *v = find(obj, "grade"); v && std::holds_alternative<std::string>(v->v) && !std::get<std::string>(v->v).empty())
+    {
+        m.grade = std::get<std::string>(v->v)[0];
+    }
+    mapNumber(obj, "timestamp", m.timestamp);
+    if (auto *v = find(obj, "endpoint"); v && std::holds_alternative<std::unique_ptr<Object>>(v->v))
+    {
+        const Object &ep = *std::get<std::unique_ptr<Object>>(v->v);
+        mapString(ep, "host", m.endpoint.host);
+        mapNumber(ep, "port", m.endpoint.port);
+        mapBool(ep, "tls", m.endpoint.tls);
+    }
+    if (auto *v = find(obj, "latencies"); v && std::holds_alternative<std::unique_ptr<Array>>(v->v))
+    {
+        m.latencies.clear();
+        for (const auto &e : *std::get<std::unique_ptr<Array>>(v->v))
+        {
+            if (std::holds_alternative<double>(e.v))
+            {
+                m.latencies.push_back(static_cast<int>(std::get<double>(e.v)));
+            }
+        }
+    }
+    return true;
+}
+
+template <typename F>
+static void run(const char *label, size_t iterations, size_t bytes, F &&f)
+{
+    size_t before = g_allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        f();
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+    double allocs = static_cast<double>(g_allocations.load() - before) / iterations;
+    std::printf("%-28s %8.1f ns  %7.1f MB/s  %6.2f allocs/op\n", label, ns, bytes / ns * 1e3, allocs);
+}
+
+int main()
+{
+    constexpr size_t kIterations = 200'000;
+    Metrics m{};
+    m.id = 7;
+    m.region = "eu-west";
+    m.cpu = 0.734;
+    m.memory = 12.5;
+    m.rx_bytes = 123456789012;
+    m.tx_bytes = 98765432109;
+    m.connections = 1024;
+    m.healthy = true;
+    m.load1 = 1.5f;
+    m.load5 = 1.25f;
+    m.load15 = 0.75f;
+    m.version = "2.4.1";
+    m.pid = 31337;
+    m.uptime = 86400.5;
+    m.message = "disk \"sda\" at 91%\n";
+    m.grade = 'A';
+    m.timestamp = 1700000000123;
+    m.endpoint = {"node-07.cluster.local", 8443, true};
+    m.latencies = {12, 15, 9, 31, 8, 22, 17, 11};
+
+    // 在序列化结果前后插入未知字段，模拟上游新增的字段
+    std::string body = reflection::toJson(m);
+    std::string json = "{\"schema\": 3, \"tags\": {\"team\": \"infra\", \"labels\": [\"a\", \"b\", {\"x\": [1, 2]}]}, " +
+                       body.substr(1, body.size() - 2) + ", \"trace\": \"0af7651916cd43dd8448eb211c80319c\"}";
+    std::printf("%s\n\n", json.c_str());
+
+    Metrics parsed{};
+    if (!reflection::fromJson(json, parsed) || reflection::toJson(parsed) != body)
+    {
+        std::printf("round trip mismatch: %s\n", reflection::toJson(parsed).c_str());
+        return 1;
+    }
+    Metrics mapped{};
+    if (!domParse(json, mapped) || reflection::toJson(mapped) != body)
+    {
+        std::printf("dom mapping mismatch: %s\n", reflection::toJson(mapped).c_str());
+        return 1;
+    }
+
+    std::vector<uint32_t> structurals;
+    run("stage 1 only", kIterations, json.size(), [&]
+        { reflection::json::findStructurals(json, structurals); });
+    run("DOM + manual mapping", kIterations, json.size(), [&]
+        { domParse(json, mapped); });
+    reflection::json::Reader reader;
+    run("json::Reader (reused)", kIterations, json.size(), [&]
+        { reader.parse(json, parsed); });
+    run("fromJson", kIterations, json.size(), [&]
+        { reflection::fromJson(json, parsed); });
+    return 0;
+}
@@ -0,0 +1,516 @@
+#ifndef SIMPLE_REFLECTION_BINARY_CODEC_HPP_
+#define SIMPLE_REFLECTION_BINARY_CODEC_HPP_
+
+#include "reflect.h"
+#include "buffer.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// 由反射信息生成的二进制编解码
+// 线上格式: 按成员声明顺序依次写出，整数/枚举按Options选择定长或变长，浮点按本机字节序原样写出，bool写1字节0/1，
+// 字符串和vector先写varint长度再写内容，嵌套的反射结构体递归展开。
+// 定长模式下相邻且中间没有填充的平凡成员合并成一次memcpy，整个结构体都满足时直接整体拷贝。
+namespace reflection::binary
+{
+    enum class IntEncoding
+    {
+        Fixed,        // 按sizeof原样写出
+        Varint,       // LEB128变长，有符号数按64位补码编码(负数固定10字节)
+        ZigZagVarint, // 有符号数先zig-zag再LEB128，小的负数也很短
+    };
+
+    struct Options
+    {
+        IntEncoding integers = IntEncoding::Fixed;
+    };
+
+    inline constexpr Options kFixed{IntEncoding::Fixed};
+    inline constexpr Options kVarint{IntEncoding::Varint};
+    inline constexpr Options kZigZag{IntEncoding::ZigZagVarint};
+
+    // 解码输入，越界或格式错误时ok置为false且后续读取全部失败
+    struct Reader
+    {
+        const char *cur;
+        const char *end;
+        bool ok = true;
+
+        explicit Reader(std::string_view input) : cur(input.data()), end(input.data() + input.size()) {}
+
+        size_t remaining() const { return static_cast<size_t>(end - cur); }
+
+        // 失败时把cur移到末尾，之后的读取只需检查剩余长度
+        bool fail()
+        {
+            ok = false;
+            cur = end;
+            return false;
+        }
+
+        bool read(void *dst, size_t n)
+        {
+            if (remaining() < n) [[unlikely]]
+            {
+                return fail();
+            }
+            if (n == 0)
+            {
+                return true; // 解码到空vector时dst可能是nullptr
+            }
+            std::memcpy(dst, cur, n);
+            cur += n;
+            return true;
+        }
+
+        bool readVarint(uint64_t &value)
+        {
+            uint64_t result = 0;
+            for (int shift = 0; shift < 64 && cur != end; shift += 7)
+            {
+                auto byte = static_cast<uint8_t>(*cur++);
+                result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                if ((byte & 0x80) == 0)
+                {
+                    value = result;
+                    return true;
+                }
+            }
+            return fail();
+        }
+
+        // 不拷贝，直接返回输入中的一段
+        bool take(size_t n, std::string_view &out)
+        {
+            if (remaining() < n) [[unlikely]]
+            {
+                return fail();
+            }
+            out = std::string_view(cur, n);
+            cur += n;
+            return true;
+        }
+    };
+
+    namespace details
+    {
+        template <typename T>
+        struct is_std_array : std::false_type
+        {
+        };
+        template <typename E, size_t N>
+        struct is_std_array<std::array<E, N>> : std::true_type
+        {
+        };
+
+        template <typename T>
+        struct is_std_vector : std::false_type
+        {
+        };
+        template <typename E, typename A>
+        struct is_std_vector<std::vector<E, A>> : std::true_type
+        {
+        };
+
+        template <typename T, Options Opt, bool Decode = false>
+        constexpr bool isFlat();
+
+        // 是否可以按内存原样拷贝(线上表示与内存表示一致)
+        // bool只有0/1是合法的对象表示，解码时不能把输入字节直接拷进去，要逐个检查，所以Decode时不算
+        template <typename M, Options Opt, bool Decode = false>
+        constexpr bool isRaw()
+        {
+            if constexpr (Reflectable<M>)
+            {
+                return isFlat<M, Opt, Decode>();
+            }
+            else if constexpr (std::is_same_v<M, bool>)
+            {
+                return !Decode;
+            }
+            else if constexpr (std::is_floating_point_v<M>)
+            {
+                return true;
+            }
+            else if constexpr (std::is_integral_v<M> || std::is_enum_v<M>)
+            {
+                return Opt.integers == IntEncoding::Fixed;
+            }
+            else if constexpr (is_std_array<M>::value)
+            {
+                return isRaw<typename M::value_type, Opt, Decode>();
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        // 整个结构体可以一次memcpy: 所有成员可原样拷贝，且成员大小之和等于sizeof(T)(没有填充也没有未反射的成员)
+        template <typename T, Options Opt, bool Decode>
+        constexpr bool isFlat()
+        {
+            if constexpr (!std::is_trivially_copyable_v<T>)
+            {
+                return false;
+            }
+            else
+            {
+                bool raw = true;
+                size_t total = 0;
+                for_each_member<T>([&](const auto &field)
+                                   {
+                    using M = typename std::remove_cvref_t<decltype(field)>::member_type;
+                    raw = raw && isRaw<M, Opt, Decode>();
+                    total += sizeof(M); });
+                return raw && total == sizeof(T);
+            }
+        }
+
+        inline size_t writeVarint(char *p, uint64_t value)
+        {
+            size_t n = 0;
+            while (value >= 0x80)
+            {
+                p[n++] = static_cast<char>(value | 0x80);
+                value >>= 7;
+            }
+            p[n++] = static_cast<char>(value);
+            return n;
+        }
+
+        template <typename Buffer>
+        void appendVarint(Buffer &out, uint64_t value)
+        {
+            out.commit(writeVarint(out.prepare(10), value));
+        }
+
+        template <Options Opt, typename I>
+        uint64_t toWire(I value)
+        {
+            if constexpr (std::is_enum_v<I>)
+            {
+                return toWire<Opt>(static_cast<std::underlying_type_t<I>>(value));
+            }
+            else if constexpr (std::is_signed_v<I> && Opt.integers == IntEncoding::ZigZagVarint)
+            {
+                auto v = static_cast<int64_t>(value);
+                return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+            }
+            else
+            {
+                return static_cast<uint64_t>(static_cast<std::conditional_t<std::is_signed_v<I>, int64_t, uint64_t>>(value));
+            }
+        }
+
+        // 超出目标类型范围的值说明输入损坏(或编码两端的类型不一致)，返回false而不是截断
+        template <Options Opt, typename I>
+        bool fromWire(uint64_t wire, I &value)
+        {
+            if constexpr (std::is_enum_v<I>)
+            {
+                std::underlying_type_t<I> raw{};
+                if (!fromWire<Opt>(wire, raw))
+                {
+                    return false;
+                }
+                value = static_cast<I>(raw);
+                return true;
+            }
+            else if constexpr (std::is_signed_v<I>)
+            {
+                int64_t v = static_cast<int64_t>(wire);
+                if constexpr (Opt.integers == IntEncoding::ZigZagVarint)
+                {
+                    v = static_cast<int64_t>((wire >> 1) ^ (~(wire & 1) + 1));
+                }
+                if (v < std::numeric_limits<I>::min() || v > std::numeric_limits<I>::max())
+                {
+                    return false;
+                }
+                value = static_cast<I>(v);
+                return true;
+            }
+            else
+            {
+                if (wire > std::numeric_limits<I>::max())
+                {
+                    return false;
+                }
+                value = static_cast<I>(wire);
+                return true;
+            }
+        }
+
+        template <Options Opt, typename T, typename Buffer>
+        void encodeStruct(const T &obj, Buffer &out);
+
+        template <Options Opt, typename T>
+        void decodeStruct(Reader &in, T &obj);
+
+        template <Options Opt, typename M, typename Buffer>
+        void encodeValue(const M &value, Buffer &out)
+        {
+            if constexpr (isRaw<M, Opt>())
+            {
+                out.append(&value, sizeof(M));
+            }
+            else if constexpr (Reflectable<M>)
+            {
+                encodeStruct<Opt>(value, out);
+            }
+            else if constexpr (std::is_integral_v<M> || std::is_enum_v<M>)
+            {
+                appendVarint(out, toWire<Opt>(value));
+            }
+            else if constexpr (std::is_same_v<M, std::string> || std::is_same_v<M, std::string_view>)
+            {
+                appendVarint(out, value.size());
+                out.append(value.data(), value.size());
+            }
+            else if constexpr (is_std_vector<M>::value || is_std_array<M>::value)
+            {
+                using E = typename M::value_type;
+                if constexpr (is_std_vector<M>::value)
+                {
+                    appendVarint(out, value.size());
+                }
+                if constexpr (isRaw<E, Opt>() && !std::is_same_v<E, bool>)
+                {
+                    out.append(value.data(), value.size() * sizeof(E));
+                }
+                else
+                {
+                    for (const auto &e : value)
+                    {
+                        encodeValue<Opt>(static_cast<const E &>(e), out);
+                    }
+                }
+            }
+            else
+            {
+                static_assert(sizeof(M) == 0, "binary codec: unsupported member type");
+            }
+        }
+
+        template <Options Opt, typename M>
+        void decodeValue(Reader &in, M &value)
+        {
+            if constexpr (isRaw<M, Opt, true>())
+            {
+                in.read(&value, sizeof(M));
+            }
+            else if constexpr (std::is_same_v<M, bool>)
+            {
+                uint8_t byte = 0;
+                if (in.read(&byte, 1))
+                {
+                    if (byte > 1) [[unlikely]]
+                    {
+                        in.fail();
+                        return;
+                    }
+                    value = byte != 0;
+                }
+            }
+            else if constexpr (Reflectable<M>)
+            {
+                decodeStruct<Opt>(in, value);
+            }
+            else if constexpr (std::is_integral_v<M> || std::is_enum_v<M>)
+            {
+                uint64_t wire = 0;
+                if (in.readVarint(wire) && !fromWire<Opt>(wire, value))
+                {
+                    in.fail();
+                }
+            }
+            else if constexpr (std::is_same_v<M, std::string>)
+            {
+                // assign复用已有容量，反复解码到同一个对象时没有分配
+                uint64_t n = 0;
+                std::string_view bytes;
+                if (in.readVarint(n) && in.take(n, bytes))
+                {
+                    value.assign(bytes);
+                }
+            }
+            else if constexpr (std::is_same_v<M, std::string_view>)
+            {
+                // 零拷贝，指向输入缓冲区，生命周期由调用方保证
+                uint64_t n = 0;
+                if (in.readVarint(n))
+                {
+                    in.take(n, value);
+                }
+            }
+            else if constexpr (is_std_vector<M>::value)
+            {
+                using E = typename M::value_type;
+                uint64_t n = 0;
+                if (!in.readVarint(n) || n > in.remaining())
+                {
+                    in.fail(); // 每个元素至少1字节，长度不可能超过剩余输入
+                    return;
+                }
+                value.resize(n);
+                if constexpr (isRaw<E, Opt, true>())
+                {
+                    in.read(value.data(), n * sizeof(E));
+                }
+                else
+                {
+                    // 直接解码到已有元素里，复用它们的容量(string、vector成员等)
+                    for (size_t i = 0; i < n && in.ok; ++i)
+                    {
+                        if constexpr (std::is_same_v<E, bool>)
+                        {
+                            bool e = false; // vector<bool>的元素是代理对象
+                            decodeValue<Opt>(in, e);
+                            value[i] = e;
+                        }
+                        else
+                        {
+                            decodeValue<Opt>(in, value[i]);
+                        }
+                    }
+                }
+            }
+            else if constexpr (is_std_array<M>::value)
+            {
+                for (auto &e : value)
+                {
+                    decodeValue<Opt>(in, e);
+                }
+            }
+            else
+            {
+                static_assert(sizeof(M) == 0, "binary codec: unsupported member type");
+            }
+        }
+
+        // 逐成员编码，地址相邻的可原样拷贝成员攒成一段再一次性memcpy
+        // 成员偏移在内联后都是常量，相邻判断会被编译器折叠掉
+        template <Options Opt, typename T, typename Buffer>
+        void encodeStruct(const T &obj, Buffer &out)
+        {
+            if constexpr (isFlat<T, Opt>())
+            {
+                out.append(&obj, sizeof(T));
+            }
+            else
+            {
+                const char *runBegin = nullptr;
+                size_t runSize = 0;
+                auto flush = [&]
+                {
+                    if (runSize)
+                    {
+                        out.append(runBegin, runSize);
+                        runSize = 0;
+                    }
+                };
+                for_each_member(obj, [&](const auto &, const auto &value)
+                                {
+                    using M = std::remove_cvref_t<decltype(value)>;
+                    if constexpr (isRaw<M, Opt>())
+                    {
+                        const char *p = reinterpret_cast<const char *>(&value);
+                        if (runSize && runBegin + runSize == p)
+                        {
+                            runSize += sizeof(M);
+                        }
+                        else
+                        {
+                            flush();
+                            runBegin = p;
+                            runSize = sizeof(M);
+                        }
+                    }
+                    else
+                    {
+                        flush();
+                        encodeValue<Opt>(value, out);
+                    } });
+                flush();
+            }
+        }
+
+        template <Options Opt, typename T>
+        void decodeStruct(Reader &in, T &obj)
+        {
+            if constexpr (isFlat<T, Opt, true>())
+            {
+                in.read(&obj, sizeof(T));
+            }
+            else
+            {
+                char *runBegin = nullptr;
+                size_t runSize = 0;
+                auto flush = [&]
+                {
+                    if (runSize)
+                    {
+                        in.read(runBegin, runSize);
+                        runSize = 0;
+                    }
+                };
+                for_each_member(obj, [&](const auto &, auto &value)
+                                {
+                    using M = std::remove_cvref_t<decltype(value)>;
+                    if constexpr (isRaw<M, Opt, true>())
+                    {
+                        char *p = reinterpret_cast<char *>(&value);
+                        if (runSize && runBegin + runSize == p)
+                        {
+                            runSize += sizeof(M);
+                        }
+                        else
+                        {
+                            flush();
+                            runBegin = p;
+                            runSize = sizeof(M);
+                        }
+                    }
+                    else
+                    {
+                        flush();
+                        decodeValue<Opt>(in, value);
+                    } });
+                flush();
+            }
+        }
+    } // namespace details
+
+    // 追加编码结果到调用方提供的缓冲区(不会先清空)，缓冲区可反复复用
+    template <Options Opt = kFixed, Reflectable T, typename Buffer>
+    void encode(const T &obj, Buffer &out)
+    {
+        details::encodeStruct<Opt>(obj, out);
+    }
+
+    // 就地解码到已有对象，字符串/vector复用原有容量；用于连续解码多条消息
+    template <Options Opt = kFixed, Reflectable T>
+    bool decode(Reader &in, T &obj)
+    {
+        details::decodeStruct<Opt>(in, obj);
+        return in.ok;
+    }
+
+    // 解码一条完整的消息，输入必须恰好用完
+    template <Options Opt = kFixed, Reflectable T>
+    bool decode(std::string_view input, T &obj)
+    {
+        Reader in(input);
+        return decode<Opt>(in, obj) && in.remaining() == 0;
+    }
+
+} // namespace reflection::binary
+
+#endif // SIMPLE_REFLECTION_BINARY_CODEC_HPP_
@@ -0,0 +1,103 @@
+#ifndef SIMPLE_REFLECTION_BUFFER_HPP_
+#define SIMPLE_REFLECTION_BUFFER_HPP_
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace reflection
+{
+    // 可复用的输出缓冲区
+    // - 自带InlineSize字节的内联存储，小消息完全不触碰堆
+    // - 超出后按2倍扩容到堆上；clear()只重置长度，容量保留给下一次使用
+    // - 提供value_type/push_back，可以配合std::back_inserter给std::format_to使用
+    template <size_t InlineSize = 512>
+    class BasicOutputBuffer
+    {
+    public:
+        using value_type = char;
+
+        BasicOutputBuffer() = default;
+        BasicOutputBuffer(const BasicOutputBuffer &) = delete;
+        BasicOutputBuffer &operator=(const BasicOutputBuffer &) = delete;
+
+        const char *data() const { return _data; }
+        char *data() { return _data; }
+        size_t size() const { return _size; }
+        size_t capacity() const { return _capacity; }
+        bool empty() const { return _size == 0; }
+        std::string_view view() const { return {_data, _size}; }
+        std::string str() const { return std::string(_data, _size); }
+
+        void clear() { _size = 0; }
+
+        void reserve(size_t n)
+        {
+            if (n > _capacity)
+            {
+                grow(n);
+            }
+        }
+
+        // 预留n字节并返回写入位置，写完后用commit提交实际写入的长度
+        char *prepare(size_t n)
+        {
+            if (_size + n > _capacity)
+            {
+                grow(_size + n);
+            }
+            return _data + _size;
+        }
+
+        void commit(size_t n) { _size += n; }
+
+        void append(const void *src, size_t n)
+        {
+            if (n == 0)
+            {
+                return; // 空vector的data()可能是nullptr，不能传给memcpy
+            }
+            std::memcpy(prepare(n), src, n);
+            _size += n;
+        }
+
+        void append(std::string_view s) { append(s.data(), s.size()); }
+
+        void push_back(char c)
+        {
+            if (_size == _capacity)
+            {
+                grow(_size + 1);
+            }
+            _data[_size++] = c;
+        }
+
+    private:
+        void grow(size_t required)
+        {
+            size_t capacity = _capacity * 2;
+            if (capacity < required)
+            {
+                capacity = required;
+            }
+            auto heap = std::make_unique_for_overwrite<char[]>(capacity);
+            std::memcpy(heap.get(), _data, _size);
+            _heap = std::move(heap);
+            _data = _heap.get();
+            _capacity = capacity;
+        }
+
+        char _inline[InlineSize];
+        std::unique_ptr<char[]> _heap;
+        char *_data = _inline;
+        size_t _size = 0;
+        size_t _capacity = InlineSize;
+    };
+
+    using OutputBuffer = BasicOutputBuffer<>;
+
+} // namespace reflection
+
+#endif // SIMPLE_REFLECTION_BUFFER_HPP_
@@ -0,0 +1,332 @@
+#ifndef SIMPLE_REFLECTION_COMPARE_HPP_
+#define SIMPLE_REFLECTION_COMPARE_HPP_
+
+#include "reflect.h"
+
+#include <algorithm>
+#include <array>
+#include <compare>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// 由成员列表生成的哈希、相等和三路比较，代替每个结构体手写的operator==、std::hash和比较器
+// - 没有填充、每个字节都属于反射成员、且所有成员的值与字节表示一一对应(整数、枚举、bool、指针)时，
+//   equal是一次memcmp，hash是对整块内存的一次哈希
+// - 其他布局(浮点、std::string、vector等)逐成员展开，全部在编译期内联，不经过TypeDescriptor的虚函数
+// - compare总是逐成员比较: 小端机器上memcmp的字节序和按成员的字典序不一致
+namespace reflection
+{
+    namespace details
+    {
+        template <typename T>
+        struct is_sequence : std::false_type
+        {
+        };
+        template <typename E, typename A>
+        struct is_sequence<std::vector<E, A>> : std::true_type
+        {
+        };
+        template <typename E, size_t N>
+        struct is_sequence<std::array<E, N>> : std::true_type
+        {
+        };
+
+        // 可以按字节比较和哈希: 值相等当且仅当字节相同
+        template <typename T>
+        constexpr bool isBitwiseComparable()
+        {
+            if constexpr (!std::is_trivially_copyable_v<T> || !std::has_unique_object_representations_v<T>)
+            {
+                return false;
+            }
+            else if constexpr (Reflectable<T>)
+            {
+                // 未反射的成员不参与比较，所以还要求成员大小之和等于sizeof(T)
+                bool bitwise = true;
+                size_t total = 0;
+                for_each_member<T>([&](const auto &field)
+                                   {
+                    using M = typename std::remove_cvref_t<decltype(field)>::member_type;
+                    bitwise = bitwise && isBitwiseComparable<M>();
+                    total += sizeof(M); });
+                return bitwise && total == sizeof(T);
+            }
+            else
+            {
+                return true;
+            }
+        }
+
+        inline uint64_t mix(uint64_t a, uint64_t b)
+        {
+#ifdef __SIZEOF_INT128__
+            __uint128_t r = static_cast<__uint128_t>(a) * b;
+            return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+#else
+            uint64_t lo = a * b;
+            uint64_t hi = (a >> 32) * (b >> 32) + (((a & 0xffffffff) * (b >> 32)) >> 32) + (((a >> 32) * (b & 0xffffffff)) >> 32);
+            return lo ^ hi;
+#endif
+        }
+
+        inline uint64_t load64(const unsigned char *p)
+        {
+            uint64_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        inline uint64_t load32(const unsigned char *p)
+        {
+            uint32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        inline constexpr uint64_t kHashSeed = 0xa0761d6478bd642fULL;
+        inline constexpr uint64_t kHashMul0 = 0xe7037ed1a0b428dbULL;
+        inline constexpr uint64_t kHashMul1 = 0x8ebc6af09c88c6e3ULL;
+
+        // 按16字节一步的乘法混合哈希(wyhash的思路)，尾部用重叠读取，不逐字节处理
+        // 对sizeof已知的结构体，循环在编译期完全展开
+        inline uint64_t hashBytes(const void *data, size_t n, uint64_t seed = kHashSeed)
+        {
+            const unsigned char *p = static_cast<const unsigned char *>(data);
+            uint64_t h = seed ^ mix(n ^ kHashMul0, kHashMul1);
+            while (n > 16)
+            {
+                h = mix(load64(p) ^ kHashMul0, load64(p + 8) ^ h);
+                p += 16;
+                n -= 16;
+            }
+            uint64_t a = 0;
+            uint64_t b = 0;
+            if (n >= 8)
+            {
+                a = load64(p);
+                b = load64(p + n - 8);
+            }
+            else if (n >= 4)
+            {
+                a = load32(p);
+                b = load32(p + n - 4);
+            }
+            else if (n > 0)
+            {
+                a = (uint64_t(p[0]) << 16) | (uint64_t(p[n >> 1]) << 8) | p[n - 1];
+            }
+            return mix(a ^ kHashMul0 ^ n, mix(b ^ kHashMul1, h ^ kHashSeed));
+        }
+
+        // 把一个成员的哈希并入结果
+        inline uint64_t combine(uint64_t h, uint64_t value)
+        {
+            return mix(h ^ value, kHashMul1);
+        }
+
+        template <typename T>
+        uint64_t hashValue(const T &value)
+        {
+            if constexpr (isBitwiseComparable<T>())
+            {
+                return hashBytes(&value, sizeof(T));
+            }
+            else if constexpr (Reflectable<T>)
+            {
+                uint64_t h = kHashSeed;
+                for_each_member(value, [&](const auto &, const auto &member)
+                                { h = combine(h, hashValue(member)); });
+                return h;
+            }
+            else if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>)
+            {
+                return hashBytes(value.data(), value.size());
+            }
+            else if constexpr (std::is_floating_point_v<T>)
+            {
+                // -0.0 == 0.0，两者的哈希也要相同
+                T normalized = value == T(0) ? T(0) : value;
+                return hashBytes(&normalized, sizeof(T));
+            }
+            else if constexpr (is_sequence<T>::value)
+            {
+                using E = typename T::value_type;
+                // vector<bool>按位压缩存放，没有data()，逐元素处理(元素是代理对象，先转成bool)
+                if constexpr (isBitwiseComparable<E>() && !std::is_same_v<E, bool>)
+                {
+                    return hashBytes(value.data(), value.size() * sizeof(E));
+                }
+                else
+                {
+                    uint64_t h = kHashSeed ^ value.size();
+                    for (const auto &e : value)
+                    {
+                        h = combine(h, hashValue(static_cast<const E &>(e)));
+                    }
+                    return h;
+                }
+            }
+            else
+            {
+                return std::hash<T>{}(value);
+            }
+        }
+
+        template <typename T>
+        bool equalValue(const T &a, const T &b)
+        {
+            if constexpr (isBitwiseComparable<T>())
+            {
+                return std::memcmp(&a, &b, sizeof(T)) == 0;
+            }
+            else if constexpr (Reflectable<T>)
+            {
+                return std::apply([&](const auto &...field)
+                                  { return (equalValue(field.get(a), field.get(b)) && ...); },
+                                  members_v<T>);
+            }
+            else if constexpr (is_sequence<T>::value)
+            {
+                using E = typename T::value_type;
+                if (a.size() != b.size())
+                {
+                    return false;
+                }
+                if constexpr (isBitwiseComparable<E>() && !std::is_same_v<E, bool>)
+                {
+                    return a.size() == 0 || std::memcmp(a.data(), b.data(), a.size() * sizeof(E)) == 0;
+                }
+                else
+                {
+                    return std::equal(a.begin(), a.end(), b.begin(), [](const E &x, const E &y)
+                                      { return equalValue(x, y); });
+                }
+            }
+            else
+            {
+                return a == b;
+            }
+        }
+
+        template <typename T>
+        auto compareValue(const T &a, const T &b);
+
+        // 三路比较的结果类型: 各成员结果类型的公共类别，如含浮点成员时为partial_ordering
+        template <typename T>
+        struct compare_category
+        {
+            using type = std::compare_three_way_result_t<T>;
+        };
+
+        template <typename E, typename A>
+        struct compare_category<std::vector<E, A>>
+        {
+            using type = typename compare_category<E>::type;
+        };
+
+        template <typename E, size_t N>
+        struct compare_category<std::array<E, N>>
+        {
+            using type = typename compare_category<E>::type;
+        };
+
+        template <Reflectable T>
+        struct compare_category<T>
+        {
+            template <size_t... I>
+            static auto deduce(std::index_sequence<I...>)
+                -> std::common_comparison_category_t<typename compare_category<
+                    typename std::remove_cvref_t<decltype(std::get<I>(members_v<T>))>::member_type>::type...>;
+
+            using type = decltype(deduce(std::make_index_sequence<member_count_v<T>>{}));
+        };
+
+        template <typename T>
+        using compare_category_t = typename compare_category<T>::type;
+
+        template <typename T>
+        auto compareValue(const T &a, const T &b)
+        {
+            using R = compare_category_t<T>;
+            if constexpr (Reflectable<T>)
+            {
+                // 按声明顺序逐成员比较，遇到第一个不相等的成员就返回
+                R result = R::equivalent;
+                std::apply([&](const auto &...field)
+                           { (((result = compareValue(field.get(a), field.get(b))) == 0) && ...); },
+                           members_v<T>);
+                return result;
+            }
+            else if constexpr (is_sequence<T>::value)
+            {
+                using E = typename T::value_type;
+                return std::lexicographical_compare_three_way(a.begin(), a.end(), b.begin(), b.end(),
+                                                              [](const E &x, const E &y) -> R
+                                                              { return compareValue(x, y); });
+            }
+            else
+            {
+                return static_cast<R>(std::compare_three_way{}(a, b));
+            }
+        }
+    } // namespace details
+
+    // 成员的哈希，相等的对象哈希相同
+    template <typename T>
+    uint64_t hash(const T &value)
+    {
+        return details::hashValue(value);
+    }
+
+    // 所有反射成员都相等
+    template <typename T>
+    bool equal(const T &a, const T &b)
+    {
+        return details::equalValue(a, b);
+    }
+
+    // 按成员声明顺序的字典序三路比较
+    template <typename T>
+    auto compare(const T &a, const T &b)
+    {
+        return details::compareValue(a, b);
+    }
+
+    // 可直接用作容器模板参数的函数对象:
+    // std::unordered_map<Key, Value, reflection::hasher, reflection::equal_to>
+    // std::map<Key, Value, reflection::less>
+    struct hasher
+    {
+        template <typename T>
+        size_t operator()(const T &value) const
+        {
+            return static_cast<size_t>(reflection::hash(value));
+        }
+    };
+
+    struct equal_to
+    {
+        template <typename T>
+        bool operator()(const T &a, const T &b) const
+        {
+            return reflection::equal(a, b);
+        }
+    };
+
+    struct less
+    {
+        template <typename T>
+        bool operator()(const T &a, const T &b) const
+        {
+            return reflection::compare(a, b) < 0;
+        }
+    };
+
+} // namespace reflection
+
+#endif // SIMPLE_REFLECTION_COMPARE_HPP_
@@ -12,15 +12,14 @@
 
 struct person
 {
-    ENABLE_REFLECT();
-    REFLECTABLE(std::string, name);
-    REFLECTABLE(int, age);
+    ENABLE_REFLECT(person)
+    REFLECTABLE(person, std::string, name)
+    REFLECTABLE(person, int, age)
 };
 
-// 在某个cpp文件中定义静态成员并注册所有字段
-DEFINE_REFLECTION(person,
-                  REFLECT_MEMBER(person, std::string, name),
-                  REFLECT_MEMBER(person, int, age));
+// 成员列表在编译期就确定了
+static_assert(reflection::member_count_v<person> == 2);
+static_assert(std::get<1>(reflection::members_v<person>).name == "age");
 
 int main()
 {
@@ -28,6 +27,11 @@ int main()
     p.name = "Alice";
     p.age = 25;
 
+    // 编译期路径: 展开遍历，没有虚函数调用
+    reflection::for_each_member(p, [](const auto &field, const auto &value)
+                                { std::cout << field.name << ": " << value << std::endl; });
+
+    // 运行时路径: 第一次调用时由编译期成员列表生成描述符
     auto desc = reflection::getDescriptor<person>();
     std::cout << desc->dump(&p) << std::endl;
 
@@ -0,0 +1,760 @@
+#ifndef SIMPLE_REFLECTION_JSON_READER_HPP_
+#define SIMPLE_REFLECTION_JSON_READER_HPP_
+
+#include "reflect.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMPLE_REFLECTION_JSON_SSE2 1
+#endif
+
+// 把JSON解析进反射结构体，分两个阶段(思路来自simdjson):
+// 1. 结构扫描: 每次处理64字节，用SIMD比较得到引号、反斜杠、结构字符的位掩码，
+//    算出被转义的引号和字符串内部区域，输出字符串外所有结构字符 {}[]:, 和引号的位置
+// 2. 按结构位置遍历: 成员名通过每个结构体在编译期生成的完美哈希表定位，再展开到对应成员的解析代码；
+//    未知成员按结构位置直接跳过，不分配内存；数字用std::from_chars解析
+// 只对实际映射到成员的值做校验，被跳过的值只检查括号配对
+namespace reflection::json
+{
+    namespace details
+    {
+        struct BlockMasks
+        {
+            uint64_t quote;
+            uint64_t backslash;
+            uint64_t op;
+        };
+
+        // 64字节块中各类字符的位掩码，第i位对应第i个字节
+        inline BlockMasks scanBlock(const char *p)
+        {
+            BlockMasks masks{0, 0, 0};
+#ifdef SIMPLE_REFLECTION_JSON_SSE2
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i backslash = _mm_set1_epi8('\\');
+            const __m128i lbrace = _mm_set1_epi8('{');
+            const __m128i rbrace = _mm_set1_epi8('}');
+            const __m128i lbracket = _mm_set1_epi8('[');
+            const __m128i rbracket = _mm_set1_epi8(']');
+            const __m128i colon = _mm_set1_epi8(':');
+            const __m128i comma = _mm_set1_epi8(',');
+            for (int i = 0; i < 4; ++i)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i * 16));
+                auto bits = [&](__m128i m)
+                { return static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(m))) << (i * 16); };
+                masks.quote |= bits(_mm_cmpeq_epi8(v, quote));
+                masks.backslash |= bits(_mm_cmpeq_epi8(v, backslash));
+                __m128i op = _mm_or_si128(
+                    _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, lbrace), _mm_cmpeq_epi8(v, rbrace)),
+                                 _mm_or_si128(_mm_cmpeq_epi8(v, lbracket), _mm_cmpeq_epi8(v, rbracket))),
+                    _mm_or_si128(_mm_cmpeq_epi8(v, colon), _mm_cmpeq_epi8(v, comma)));
+                masks.op |= bits(op);
+            }
+#else
+            for (int i = 0; i < 64; ++i)
+            {
+                uint64_t bit = uint64_t(1) << i;
+                switch (p[i])
+                {
+                case '"':
+                    masks.quote |= bit;
+                    break;
+                case '\\':
+                    masks.backslash |= bit;
+                    break;
+                case '{':
+                case '}':
+                case '[':
+                case ']':
+                case ':':
+                case ',':
+                    masks.op |= bit;
+                    break;
+                default:
+                    break;
+                }
+            }
+#endif
+            return masks;
+        }
+
+        // 前缀异或: 第i位为0..i位的异或，引号掩码经过它就得到字符串内部区域(含开引号，不含闭引号)
+        inline uint64_t prefixXor(uint64_t x)
+        {
+            x ^= x << 1;
+            x ^= x << 2;
+            x ^= x << 4;
+            x ^= x << 8;
+            x ^= x << 16;
+            x ^= x << 32;
+            return x;
+        }
+
+        // 被奇数个连续反斜杠转义的字符位置，prevEscaped跨块传递上一块末尾的转义状态
+        inline uint64_t findEscaped(uint64_t backslash, uint64_t &prevEscaped)
+        {
+            constexpr uint64_t kEvenBits = 0x5555555555555555ULL;
+            backslash &= ~prevEscaped;
+            uint64_t followsEscape = (backslash << 1) | prevEscaped;
+            uint64_t oddSequenceStarts = backslash & ~kEvenBits & ~followsEscape;
+            uint64_t sequencesStartingOnEvenBits = oddSequenceStarts + backslash;
+            prevEscaped = sequencesStartingOnEvenBits < oddSequenceStarts ? 1 : 0;
+            uint64_t invertMask = sequencesStartingOnEvenBits << 1;
+            return (kEvenBits ^ invertMask) & followsEscape;
+        }
+
+        inline bool isSpace(char c)
+        {
+            return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+        }
+
+        inline std::string_view trim(const char *begin, const char *end)
+        {
+            while (begin < end && isSpace(*begin))
+            {
+                ++begin;
+            }
+            while (end > begin && isSpace(end[-1]))
+            {
+                --end;
+            }
+            return std::string_view(begin, static_cast<size_t>(end - begin));
+        }
+
+        inline void appendUtf8(std::string &out, uint32_t cp)
+        {
+            if (cp < 0x80)
+            {
+                out.push_back(static_cast<char>(cp));
+            }
+            else if (cp < 0x800)
+            {
+                out.push_back(static_cast<char>(0xc0 | (cp >> 6)));
+                out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+            }
+            else if (cp < 0x10000)
+            {
+                out.push_back(static_cast<char>(0xe0 | (cp >> 12)));
+                out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+                out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+            }
+            else
+            {
+                out.push_back(static_cast<char>(0xf0 | (cp >> 18)));
+                out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3f)));
+                out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+                out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+            }
+        }
+
+        inline bool parseHex4(const char *p, const char *end, uint32_t &value)
+        {
+            if (end - p < 4)
+            {
+                return false;
+            }
+            auto result = std::from_chars(p, p + 4, value, 16);
+            return result.ec == std::errc() && result.ptr == p + 4;
+        }
+
+        // 反转义到out，复用out已有的容量
+        inline bool unescape(std::string_view raw, std::string &out)
+        {
+            const char *p = raw.data();
+            const char *end = p + raw.size();
+            const char *slash = static_cast<const char *>(std::memchr(p, '\\', raw.size()));
+            if (!slash)
+            {
+                out.assign(raw);
+                return true;
+            }
+            out.assign(p, slash);
+            p = slash;
+            while (p < end)
+            {
+                if (*p != '\\')
+                {
+                    const char *next = static_cast<const char *>(std::memchr(p, '\\', static_cast<size_t>(end - p)));
+                    next = next ? next : end;
+                    out.append(p, next);
+                    p = next;
+                    continue;
+                }
+                if (++p == end)
+                {
+                    return false;
+                }
+                switch (*p++)
+                {
+                case '"':
+                    out.push_back('"');
+                    break;
+                case '\\':
+                    out.push_back('\\');
+                    break;
+                case '/':
+                    out.push_back('/');
+                    break;
+                case 'b':
+                    out.push_back('\b');
+                    break;
+                case 'f':
+                    out.push_back('\f');
+                    break;
+                case 'n':
+                    out.push_back('\n');
+                    break;
+                case 'r':
+                    out.push_back('\r');
+                    break;
+                case 't':
+                    out.push_back('\t');
+                    break;
+                case 'u':
+                {
+                    uint32_t cp = 0;
+                    if (!parseHex4(p, end, cp))
+                    {
+                        return false;
+                    }
+                    p += 4;
+                    // 代理对
+                    if (cp >= 0xd800 && cp < 0xdc00)
+                    {
+                        uint32_t low = 0;
+                        if (end - p < 6 || p[0] != '\\' || p[1] != 'u' || !parseHex4(p + 2, end, low) ||
+                            low < 0xdc00 || low >= 0xe000)
+                        {
+                            return false;
+                        }
+                        p += 6;
+                        cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                    }
+                    appendUtf8(out, cp);
+                    break;
+                }
+                default:
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // 成员名的完美哈希表，编译期为每个反射结构体生成
+        // 找到一个种子使所有成员名落在不同的槽里，查找时一次哈希加一次比较
+        template <Reflectable T>
+        struct MemberTable
+        {
+            static constexpr size_t kCount = member_count_v<T>;
+            static_assert(kCount < 255, "member index must fit in a slot byte");
+
+            static constexpr uint32_t hash(std::string_view s, uint32_t seed)
+            {
+                uint32_t h = 2166136261u ^ seed;
+                for (char c : s)
+                {
+                    h ^= static_cast<uint8_t>(c);
+                    h *= 16777619u;
+                }
+                return h ^ (h >> 16);
+            }
+
+            static constexpr std::array<std::string_view, kCount> names = []
+            {
+                std::array<std::string_view, kCount> result{};
+                size_t i = 0;
+                for_each_member<T>([&](const auto &field)
+                                   { result[i++] = field.name; });
+                return result;
+            }();
+
+            struct Params
+            {
+                size_t size;
+                uint32_t seed;
+            };
+
+            // 从2倍成员数的表开始找种子，找不到就把表扩大一倍
+            static constexpr Params search()
+            {
+                for (size_t size = std::bit_ceil(std::max<size_t>(kCount * 2, 2)); size <= (1u << 16); size *= 2)
+                {
+                    for (uint32_t seed = 0; seed < 4096; ++seed)
+                    {
+                        std::vector<bool> used(size, false);
+                        bool ok = true;
+                        for (auto name : names)
+                        {
+                            size_t slot = hash(name, seed) & (size - 1);
+                            if (used[slot])
+                            {
+                                ok = false;
+                                break;
+                            }
+                            used[slot] = true;
+                        }
+                        if (ok)
+                        {
+                            return {size, seed};
+                        }
+                    }
+                }
+                return {0, 0};
+            }
+
+            static constexpr Params kParams = search();
+            static_assert(kParams.size != 0, "no perfect hash found for member names");
+
+            // 槽里存成员下标+1，0表示空
+            static constexpr std::array<uint8_t, kParams.size> slots = []
+            {
+                std::array<uint8_t, kParams.size> result{};
+                for (size_t i = 0; i < kCount; ++i)
+                {
+                    result[hash(names[i], kParams.seed) & (kParams.size - 1)] = static_cast<uint8_t>(i + 1);
+                }
+                return result;
+            }();
+
+            // 返回成员下标，未知成员返回kCount
+            static size_t lookup(std::string_view key)
+            {
+                uint8_t slot = slots[hash(key, kParams.seed) & (kParams.size - 1)];
+                if (slot == 0 || names[slot - 1] != key)
+                {
+                    return kCount;
+                }
+                return slot - 1;
+            }
+        };
+
+        // 把运行期的成员下标展开成编译期的成员访问，f(field, member)
+        template <Reflectable T, typename F>
+        bool visitMember(T &obj, size_t index, F &&f)
+        {
+            return [&]<size_t... I>(std::index_sequence<I...>)
+            {
+                bool result = false;
+                ((I == index ? (result = f(std::get<I>(members_v<T>), std::get<I>(members_v<T>).get(obj)), true) : false) || ...);
+                return result;
+            }(std::make_index_sequence<member_count_v<T>>{});
+        }
+
+        template <typename T>
+        struct is_vector : std::false_type
+        {
+        };
+        template <typename E, typename A>
+        struct is_vector<std::vector<E, A>> : std::true_type
+        {
+        };
+
+        template <typename T>
+        struct is_std_array : std::false_type
+        {
+        };
+        template <typename E, size_t N>
+        struct is_std_array<std::array<E, N>> : std::true_type
+        {
+        };
+
+        // 第二阶段: 按结构字符位置遍历
+        class Parser
+        {
+        public:
+            Parser(std::string_view json, const std::vector<uint32_t> &structurals)
+                : _json(json.data()), _size(json.size()), _idx(structurals.data()), _count(structurals.size())
+            {
+            }
+
+            // 整个输入是一个对象，前后只允许空白
+            template <Reflectable T>
+            bool parseDocument(T &obj)
+            {
+                if (_count == 0 || !trim(_json, _json + _idx[0]).empty())
+                {
+                    return false;
+                }
+                return parseObject(obj) && _cur == _count && trim(_json + _idx[_count - 1] + 1, _json + _size).empty();
+            }
+
+            template <Reflectable T>
+            bool parseObject(T &obj)
+            {
+                if (!expect('{'))
+                {
+                    return false;
+                }
+                if (peek() == '}')
+                {
+                    ++_cur;
+                    return true;
+                }
+                while (true)
+                {
+                    // "key" :
+                    if (peek() != '"' || _cur + 2 >= _count)
+                    {
+                        return false;
+                    }
+                    uint32_t keyBegin = _idx[_cur] + 1;
+                    uint32_t keyEnd = _idx[_cur + 1];
+                    if (_json[keyEnd] != '"')
+                    {
+                        return false;
+                    }
+                    _cur += 2;
+                    uint32_t colon = position();
+                    if (!expect(':'))
+                    {
+                        return false;
+                    }
+
+                    std::string_view key(_json + keyBegin, keyEnd - keyBegin);
+                    // 成员名不含转义字符，带转义的键先还原再查找
+                    if (std::memchr(key.data(), '\\', key.size()))
+                    {
+                        if (!unescape(key, _key))
+                        {
+                            return false;
+                        }
+                        key = _key;
+                    }
+                    size_t index = MemberTable<T>::lookup(key);
+                    bool ok = index == member_count_v<T>
+                                  ? skipValue()
+                                  : visitMember(obj, index, [&](const auto &, auto &member)
+                                                { return parseValue(member, colon); });
+                    if (!ok)
+                    {
+                        return false;
+                    }
+
+                    char c = peek();
+                    ++_cur;
+                    if (c == '}')
+                    {
+                        return true;
+                    }
+                    if (c != ',')
+                    {
+                        return false;
+                    }
+                }
+            }
+
+        private:
+            char peek() const { return _cur < _count ? _json[_idx[_cur]] : '\0'; }
+            uint32_t position() const { return _cur < _count ? _idx[_cur] : static_cast<uint32_t>(_size); }
+
+            bool expect(char c)
+            {
+                if (peek() != c)
+                {
+                    return false;
+                }
+                ++_cur;
+                return true;
+            }
+
+            // 结构字符已经用完: 根对象还没闭合，输入被截断了
+            bool truncated() const { return _cur >= _count; }
+
+            // 标量值位于前一个结构字符(: , [)和下一个结构字符之间，调用方先排除truncated()
+            std::string_view scalar(uint32_t prev) const
+            {
+                return trim(_json + prev + 1, _json + position());
+            }
+
+            // 当前位置是开引号时取出字符串的原始内容并前进
+            bool rawString(std::string_view &raw)
+            {
+                if (peek() != '"' || _cur + 1 >= _count)
+                {
+                    return false;
+                }
+                uint32_t begin = _idx[_cur] + 1;
+                uint32_t end = _idx[_cur + 1];
+                _cur += 2;
+                raw = std::string_view(_json + begin, end - begin);
+                return true;
+            }
+
+            template <typename M>
+            bool parseValue(M &value, uint32_t prev)
+            {
+                char c = peek();
+                if constexpr (Reflectable<M>)
+                {
+                    return c == '{' ? parseObject(value) : isNull(prev);
+                }
+                else if constexpr (std::is_same_v<M, char>)
+                {
+                    // 与writeJson一致，char按单字符字符串读写
+                    std::string_view raw;
+                    if (c != '"')
+                    {
+                        return isNull(prev);
+                    }
+                    if (!rawString(raw) || !unescape(raw, _scratch) || _scratch.size() != 1)
+                    {
+                        return false;
+                    }
+                    value = _scratch[0];
+                    return true;
+                }
+                else if constexpr (std::is_same_v<M, std::string>)
+                {
+                    std::string_view raw;
+                    if (c != '"')
+                    {
+                        return isNull(prev);
+                    }
+                    return rawString(raw) && unescape(raw, value);
+                }
+                else if constexpr (is_vector<M>::value || is_std_array<M>::value)
+                {
+                    if (c != '[')
+                    {
+                        return isNull(prev);
+                    }
+                    uint32_t open = position();
+                    ++_cur;
+                    if constexpr (is_vector<M>::value)
+                    {
+                        value.clear();
+                    }
+                    if (peek() == ']' && scalar(open).empty())
+                    {
+                        ++_cur;
+                        return value.size() == 0;
+                    }
+                    uint32_t last = open;
+                    size_t count = 0;
+                    while (true)
+                    {
+                        if (!parseElement(value, count++, last))
+                        {
+                            return false;
+                        }
+                        char next = peek();
+                        last = position();
+                        ++_cur;
+                        if (next == ']')
+                        {
+                            // std::array的元素个数必须和长度一致
+                            return count == value.size();
+                        }
+                        if (next != ',')
+                        {
+                            return false;
+                        }
+                    }
+                }
+                else
+                {
+                    if (c == '"' || c == '{' || c == '[' || truncated())
+                    {
+                        return false;
+                    }
+                    std::string_view text = scalar(prev);
+                    if (text == "null")
+                    {
+                        return true;
+                    }
+                    if constexpr (std::is_same_v<M, bool>)
+                    {
+                        if (text == "true" || text == "false")
+                        {
+                            value = text[0] == 't';
+                            return true;
+                        }
+                        return false;
+                    }
+                    else if constexpr (std::is_enum_v<M>)
+                    {
+                        std::underlying_type_t<M> raw{};
+                        if (!parseNumber(text, raw))
+                        {
+                            return false;
+                        }
+                        value = static_cast<M>(raw);
+                        return true;
+                    }
+                    else if constexpr (std::is_arithmetic_v<M>)
+                    {
+                        return parseNumber(text, value);
+                    }
+                    else
+                    {
+                        static_assert(sizeof(M) == 0, "json reader: unsupported member type");
+                        return false;
+                    }
+                }
+            }
+
+            // vector追加一个元素；array按下标写入，元素多于长度时失败
+            template <typename M>
+            bool parseElement(M &value, size_t i, uint32_t prev)
+            {
+                if constexpr (is_std_array<M>::value)
+                {
+                    return i < value.size() && parseValue(value[i], prev);
+                }
+                else if constexpr (std::is_same_v<typename M::value_type, bool>)
+                {
+                    // vector<bool>的元素是代理对象，先解析到局部变量
+                    bool element = false;
+                    if (!parseValue(element, prev))
+                    {
+                        return false;
+                    }
+                    value.push_back(element);
+                    return true;
+                }
+                else
+                {
+                    return parseValue(value.emplace_back(), prev);
+                }
+            }
+
+            // 只接受JSON的数字写法: from_chars还认inf、nan和".5"这类写法，要求开头(负号之后)是数字
+            template <typename N>
+            static bool parseNumber(std::string_view text, N &value)
+            {
+                size_t digit = !text.empty() && text[0] == '-' ? 1 : 0;
+                if (digit >= text.size() || text[digit] < '0' || text[digit] > '9')
+                {
+                    return false;
+                }
+                auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+                return result.ec == std::errc() && result.ptr == text.data() + text.size();
+            }
+
+            bool isNull(uint32_t prev) const
+            {
+                char c = peek();
+                return c != '"' && c != '{' && c != '[' && !truncated() && scalar(prev) == "null";
+            }
+
+            // 跳过一个值: 对象/数组按结构位置数括号，字符串跳过两个引号，标量不占结构位置
+            bool skipValue()
+            {
+                char c = peek();
+                if (c == '"')
+                {
+                    _cur += 2;
+                    return _cur <= _count;
+                }
+                if (c != '{' && c != '[')
+                {
+                    return true;
+                }
+                int depth = 0;
+                do
+                {
+                    if (_cur >= _count)
+                    {
+                        return false;
+                    }
+                    char ch = _json[_idx[_cur++]];
+                    if (ch == '{' || ch == '[')
+                    {
+                        ++depth;
+                    }
+                    else if (ch == '}' || ch == ']')
+                    {
+                        --depth;
+                    }
+                } while (depth > 0);
+                return true;
+            }
+
+            const char *_json;
+            size_t _size;
+            const uint32_t *_idx;
+            size_t _count;
+            size_t _cur = 0;
+            std::string _scratch;
+            std::string _key;
+        };
+    } // namespace details
+
+    // 第一阶段: 输出字符串外的结构字符和所有未转义引号的位置，字符串未闭合时返回false
+    inline bool findStructurals(std::string_view json, std::vector<uint32_t> &out)
+    {
+        out.clear();
+        uint64_t prevEscaped = 0;
+        uint64_t prevInString = 0;
+        for (size_t pos = 0; pos < json.size(); pos += 64)
+        {
+            const char *block = json.data() + pos;
+            char tail[64];
+            if (json.size() - pos < 64)
+            {
+                std::memset(tail, ' ', sizeof(tail));
+                std::memcpy(tail, block, json.size() - pos);
+                block = tail;
+            }
+            details::BlockMasks masks = details::scanBlock(block);
+            uint64_t escaped = details::findEscaped(masks.backslash, prevEscaped);
+            uint64_t quote = masks.quote & ~escaped;
+            uint64_t inString = details::prefixXor(quote) ^ prevInString;
+            prevInString = static_cast<uint64_t>(static_cast<int64_t>(inString) >> 63);
+            uint64_t structurals = (masks.op & ~inString) | quote;
+            while (structurals)
+            {
+                out.push_back(static_cast<uint32_t>(pos + static_cast<size_t>(std::countr_zero(structurals))));
+                structurals &= structurals - 1;
+            }
+        }
+        return prevInString == 0;
+    }
+
+    // 可复用的解析器，结构位置数组在多次解析间保留容量，稳定后解析过程不分配内存
+    // (std::string成员的内容超出其已有容量时除外)
+    class Reader
+    {
+    public:
+        template <Reflectable T>
+        bool parse(std::string_view json, T &obj)
+        {
+            if (json.size() > UINT32_MAX || !findStructurals(json, _structurals))
+            {
+                return false;
+            }
+            details::Parser parser(json, _structurals);
+            return parser.parseDocument(obj);
+        }
+
+    private:
+        std::vector<uint32_t> _structurals;
+    };
+
+} // namespace reflection::json
+
+namespace reflection
+{
+    // toJson的反向操作，使用线程局部的json::Reader，obj中没有出现在输入里的成员保持原值；
+    // 返回false时obj可能已被部分写入
+    template <Reflectable T>
+    bool fromJson(std::string_view json, T &obj)
+    {
+        thread_local json::Reader reader;
+        return reader.parse(json, obj);
+    }
+} // namespace reflection
+
+#endif // SIMPLE_REFLECTION_JSON_READER_HPP_
@@ -0,0 +1,103 @@
+#ifndef SIMPLE_REFLECTION_JSON_WRITER_HPP_
+#define SIMPLE_REFLECTION_JSON_WRITER_HPP_
+
+#include "reflect.h"
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// 编译期路径的JSON输出: 由成员列表展开，不经过TypeDescriptor的虚函数，
+// 与StructDescriptor::dumpJsonTo输出相同的格式，额外支持enum、string_view、vector和array
+namespace reflection
+{
+    namespace details
+    {
+        template <typename T>
+        struct is_json_array : std::false_type
+        {
+        };
+        template <typename E, typename A>
+        struct is_json_array<std::vector<E, A>> : std::true_type
+        {
+        };
+        template <typename E, size_t N>
+        struct is_json_array<std::array<E, N>> : std::true_type
+        {
+        };
+    } // namespace details
+
+    template <typename Buffer, typename T>
+    void writeJson(Buffer &out, const T &value)
+    {
+        if constexpr (Reflectable<T>)
+        {
+            out.push_back('{');
+            bool first = true;
+            for_each_member(value, [&](const auto &field, const auto &member)
+                            {
+                if (!first)
+                {
+                    out.push_back(',');
+                }
+                first = false;
+                out.push_back('"');
+                out.append(field.name);
+                out.append("\":", 2);
+                writeJson(out, member); });
+            out.push_back('}');
+        }
+        else if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>)
+        {
+            text::writeJsonString(out, value);
+        }
+        else if constexpr (std::is_same_v<T, char>)
+        {
+            text::writeJsonString(out, std::string_view(&value, 1));
+        }
+        else if constexpr (std::is_same_v<T, bool>)
+        {
+            text::writeBool(out, value);
+        }
+        else if constexpr (std::is_enum_v<T>)
+        {
+            text::writeNumber(out, static_cast<std::underlying_type_t<T>>(value));
+        }
+        else if constexpr (std::is_arithmetic_v<T>)
+        {
+            text::writeJsonNumber(out, value);
+        }
+        else if constexpr (details::is_json_array<T>::value)
+        {
+            out.push_back('[');
+            bool first = true;
+            for (const auto &e : value)
+            {
+                if (!first)
+                {
+                    out.push_back(',');
+                }
+                first = false;
+                writeJson(out, static_cast<const typename T::value_type &>(e));
+            }
+            out.push_back(']');
+        }
+        else
+        {
+            static_assert(sizeof(T) == 0, "writeJson: unsupported type");
+        }
+    }
+
+    template <Reflectable T>
+    std::string toJson(const T &obj)
+    {
+        OutputBuffer out;
+        writeJson(out, obj);
+        return out.str();
+    }
+
+} // namespace reflection
+
+#endif // SIMPLE_REFLECTION_JSON_WRITER_HPP_
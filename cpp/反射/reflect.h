@@ -1,15 +1,23 @@
 #ifndef SIMPLE_REFLECTION_REFLECTION_HPP_
 #define SIMPLE_REFLECTION_REFLECTION_HPP_
 
+#include <cstring>
 #include <string>
+#include <string_view>
 #include <type_traits>
-#include <sstream>
-#include <format>
+#include <typeinfo>
 #include <vector>
+#include <tuple>
+#include <utility>
+
+#include "buffer.h"
+#include "text_format.h"
 
 namespace reflection
 {
     // 类型描述符基类
+    // dumpTo/dumpJsonTo直接写入调用方的缓冲区，嵌套成员也写进同一个缓冲区，不产生中间字符串；
+    // OutputBuffer提供push_back，自定义描述符也可以用std::format_to(std::back_inserter(out), ...)写入
     class TypeDescriptor
     {
     public:
@@ -17,7 +25,22 @@ namespace reflection
         virtual ~TypeDescriptor() = default;
         virtual const char *name() const { return _name; }
         virtual size_t size() const { return _size; }
-        virtual std::string dump(const void *obj) const = 0;
+        virtual void dumpTo(OutputBuffer &out, const void *obj) const = 0;
+        virtual void dumpJsonTo(OutputBuffer &out, const void *obj) const = 0;
+
+        std::string dump(const void *obj) const
+        {
+            OutputBuffer out;
+            dumpTo(out, obj);
+            return out.str();
+        }
+
+        std::string dumpJson(const void *obj) const
+        {
+            OutputBuffer out;
+            dumpJsonTo(out, obj);
+            return out.str();
+        }
 
     protected:
         const char *_name;
@@ -38,19 +61,74 @@ namespace reflection
     class BasicTypeDescriptor : public TypeDescriptor
     {
     public:
-        BasicTypeDescriptor() : TypeDescriptor(typeid(T).name(), sizeof(T)) {}
+        BasicTypeDescriptor() : TypeDescriptor(typeid(T).name(), sizeof(T)), _nameLength(std::strlen(_name)) {}
+
+        // 文本格式: 类型名(值)，字符串带引号
+        virtual void dumpTo(OutputBuffer &out, const void *obj) const override
+        {
+            const T &value = *(const T *)obj;
+            out.append(_name, _nameLength);
+            out.push_back('(');
+            if constexpr (std::is_same_v<T, std::string>)
+            {
+                out.push_back('"');
+                out.append(value);
+                out.push_back('"');
+            }
+            else
+            {
+                writeValue(out, value);
+            }
+            out.push_back(')');
+        }
 
-        virtual std::string dump(const void *obj) const override
+        virtual void dumpJsonTo(OutputBuffer &out, const void *obj) const override
         {
+            const T &value = *(const T *)obj;
             if constexpr (std::is_same_v<T, std::string>)
             {
-                return std::format("{}(\"{}\")", _name, *(const T *)obj);
+                text::writeJsonString(out, value);
+            }
+            else if constexpr (std::is_same_v<T, char>)
+            {
+                text::writeJsonString(out, std::string_view(&value, 1));
+            }
+            else if constexpr (std::is_same_v<T, bool>)
+            {
+                text::writeBool(out, value);
+            }
+            else if constexpr (std::is_same_v<T, std::nullptr_t>)
+            {
+                out.append("null", 4);
             }
             else
             {
-                return std::format("{}({})", _name, *(const T *)obj);
+                text::writeJsonNumber(out, value);
             }
         }
+
+    private:
+        static void writeValue(OutputBuffer &out, const T &value)
+        {
+            if constexpr (std::is_same_v<T, char>)
+            {
+                out.push_back(value);
+            }
+            else if constexpr (std::is_same_v<T, bool>)
+            {
+                text::writeBool(out, value);
+            }
+            else if constexpr (std::is_same_v<T, std::nullptr_t>)
+            {
+                out.append("nullptr", 7);
+            }
+            else
+            {
+                text::writeNumber(out, value);
+            }
+        }
+
+        size_t _nameLength;
     };
 
     // 成员描述符
@@ -86,25 +164,96 @@ namespace reflection
 
         const std::vector<MemberDescriptor> &getMembers() const { return members; }
 
-        virtual std::string dump(const void *obj) const override
+        virtual void dumpTo(OutputBuffer &out, const void *obj) const override
         {
-            std::ostringstream oss;
-            oss << _name << " {\n";
+            out.append(std::string_view(_name));
+            out.append(" {\n", 3);
             for (const auto &member : members)
             {
-                oss << "  " << member.name << " = ";
-                const char *memberAddr = reinterpret_cast<const char *>(obj) + member.offset;
-                oss << member.type->dump(memberAddr);
-                oss << "\n";
+                out.append("  ", 2);
+                out.append(std::string_view(member.name));
+                out.append(" = ", 3);
+                member.type->dumpTo(out, reinterpret_cast<const char *>(obj) + member.offset);
+                out.push_back('\n');
             }
-            oss << "}";
-            return oss.str();
+            out.push_back('}');
+        }
+
+        virtual void dumpJsonTo(OutputBuffer &out, const void *obj) const override
+        {
+            out.push_back('{');
+            bool first = true;
+            for (const auto &member : members)
+            {
+                if (!first)
+                {
+                    out.push_back(',');
+                }
+                first = false;
+                // 成员名是标识符，不需要转义
+                out.push_back('"');
+                out.append(std::string_view(member.name));
+                out.append("\":", 2);
+                member.type->dumpJsonTo(out, reinterpret_cast<const char *>(obj) + member.offset);
+            }
+            out.push_back('}');
+        }
+    };
+
+    // 成员指针萃取
+    template <typename T>
+    struct member_pointer_traits;
+
+    template <typename Class, typename Member>
+    struct member_pointer_traits<Member Class::*>
+    {
+        using class_type = Class;
+        using member_type = Member;
+    };
+
+    // 编译期成员描述: 成员指针作为模板参数，访问成员不经过偏移量和虚函数
+    template <auto MemberPtr>
+    struct Field
+    {
+        using class_type = typename member_pointer_traits<decltype(MemberPtr)>::class_type;
+        using member_type = typename member_pointer_traits<decltype(MemberPtr)>::member_type;
+        static constexpr auto pointer = MemberPtr;
+
+        std::string_view name;
+
+        static constexpr const member_type &get(const class_type &obj) { return obj.*MemberPtr; }
+        static constexpr member_type &get(class_type &obj) { return obj.*MemberPtr; }
+
+        // 成员偏移量，沿用原来的空指针写法，优化后是一个常量
+        static size_t offset()
+        {
+            return reinterpret_cast<size_t>(
+                &(reinterpret_cast<class_type const volatile *>(0)->*MemberPtr));
         }
     };
 
     // 细节实现
     namespace details
     {
+        // 编译期计数器: 每个REFLECTABLE声明一个更匹配的_reflectCounter重载，
+        // 用最深的Rank去调用时重载决议选中最后声明的那个，其返回类型就是当前的成员数
+        template <size_t N>
+        struct Rank : Rank<N - 1>
+        {
+        };
+        template <>
+        struct Rank<0>
+        {
+        };
+
+        template <size_t N>
+        struct Index
+        {
+            static constexpr size_t value = N;
+        };
+
+        inline constexpr size_t kMaxMembers = 128;
+
         template <typename T>
         TypeDescriptor *getBasicDescriptor()
         {
@@ -113,13 +262,97 @@ namespace reflection
         }
     } // namespace details
 
-    // 获取类型描述符
+    // 是否通过ENABLE_REFLECT/REFLECTABLE启用了反射
+    template <typename T>
+    concept Reflectable = requires {
+        T::_reflectCounter(details::Rank<details::kMaxMembers>{});
+        T::_reflectName();
+    };
+
+    // 成员个数
+    template <Reflectable T>
+    inline constexpr size_t member_count_v =
+        decltype(T::_reflectCounter(details::Rank<details::kMaxMembers>{}))::value;
+
+    // 编译期成员列表: std::tuple<Field<&T::a>, Field<&T::b>, ...>
+    template <Reflectable T>
+    constexpr auto members()
+    {
+        return []<size_t... I>(std::index_sequence<I...>)
+        {
+            return std::make_tuple(T::_reflectField(details::Index<I>{})...);
+        }(std::make_index_sequence<member_count_v<T>>{});
+    }
+
+    template <Reflectable T>
+    inline constexpr auto members_v = members<T>();
+
+    // 按声明顺序展开遍历每个成员的Field，f(field)
+    template <Reflectable T, typename F>
+    constexpr void for_each_member(F &&f)
+    {
+        std::apply([&](const auto &...field)
+                   { (f(field), ...); },
+                   members_v<T>);
+    }
+
+    // 遍历对象的每个成员，f(field, value)，value的常量性跟随obj
+    template <typename T, typename F>
+        requires Reflectable<std::remove_cvref_t<T>>
+    constexpr void for_each_member(T &obj, F &&f)
+    {
+        std::apply([&](const auto &...field)
+                   { (f(field, field.get(obj)), ...); },
+                   members_v<std::remove_cvref_t<T>>);
+    }
+
+    // 按名字查找成员下标，找不到返回member_count_v<T>
+    template <Reflectable T>
+    constexpr size_t member_index(std::string_view name)
+    {
+        size_t index = member_count_v<T>;
+        size_t i = 0;
+        for_each_member<T>([&](const auto &field)
+                           {
+            if (index == member_count_v<T> && field.name == name)
+            {
+                index = i;
+            }
+            ++i; });
+        return index;
+    }
+
+    template <typename T>
+    auto getDescriptor();
+
+    namespace details
+    {
+        // 运行时描述符适配: 第一次使用时由编译期成员列表生成，没有静态初始化期的注册
+        template <typename T>
+        StructDescriptor *getStructDescriptor()
+        {
+            static StructDescriptor descriptor = []
+            {
+                constexpr std::string_view declared = T::_reflectName();
+                StructDescriptor desc(declared.empty() ? typeid(T).name() : declared.data(), sizeof(T));
+                desc.members.reserve(member_count_v<T>);
+                for_each_member<T>([&](const auto &field)
+                                   {
+                    using Member = typename std::remove_cvref_t<decltype(field)>::member_type;
+                    desc.addMember(field.name.data(), field.offset(), getDescriptor<Member>()); });
+                return desc;
+            }();
+            return &descriptor;
+        }
+    } // namespace details
+
+    // 获取类型描述符，反射结构体返回StructDescriptor*，基本类型返回TypeDescriptor*
     template <typename T>
-    TypeDescriptor *getDescriptor()
+    auto getDescriptor()
     {
-        if constexpr (requires { T::getReflection; })
+        if constexpr (Reflectable<T>)
         {
-            return &T::getReflection();
+            return details::getStructDescriptor<T>();
         }
         else if constexpr (is_basic_supported<T>::value)
         {
@@ -129,39 +362,30 @@ namespace reflection
         {
             static_assert(is_basic_supported<T>::value,
                           "This type does not support reflection");
-            return nullptr;
+            return static_cast<TypeDescriptor *>(nullptr);
         }
     }
 
 } // namespace reflection
 
-// 在类内部声明反射描述符和辅助函数
-#define ENABLE_REFLECT()                                                                                           \
-    static reflection::StructDescriptor &_getReflectionImpl(                                                       \
-        const char *className, size_t classSize)                                                                   \
-    {                                                                                                              \
-        static reflection::StructDescriptor desc(className, classSize);                                            \
-        return desc;                                                                                               \
-    }                                                                                                              \
-    static reflection::StructDescriptor &getReflection()                                                           \
-    {                                                                                                              \
-        return _getReflectionImpl("", 0);                                                                          \
-    }                                                                                                              \
-    template <typename Class, typename MemberType>                                                                 \
-    static void _registerMember(const char *className, size_t classSize,                                           \
-                                const char *name, MemberType Class::*ptr)                                          \
-    {                                                                                                              \
-        size_t offset = reinterpret_cast<size_t>(                                                                  \
-            &(reinterpret_cast<Class const volatile *>(0)->*ptr));                                                 \
-        _getReflectionImpl(className, classSize).addMember(name, offset, reflection::getDescriptor<MemberType>()); \
-    }
+// 当前类中已声明的反射成员个数，只在ENABLE_REFLECT之后的类体内使用
+#define REFLECT_MEMBER_COUNT_() \
+    decltype(_reflectCounter(reflection::details::Rank<reflection::details::kMaxMembers>{}))::value
+
+// 在类内部开启反射，可选传入类名作为描述符名字: ENABLE_REFLECT() 或 ENABLE_REFLECT(person)
+// 只有声明，不产生任何静态初始化
+#define ENABLE_REFLECT(...)                                                              \
+    static constexpr std::string_view _reflectName() { return #__VA_ARGS__; }            \
+    static reflection::details::Index<0> _reflectCounter(reflection::details::Rank<0>);
 
-// 定义成员变量并注册到反射系统
-#define REFLECTABLE(class_name, member_type, member_name) \
-    member_type member_name;                              \
-    inline static const bool _reflectionInit_##member_name = [] {            \
-        class_name::_registerMember<class_name, member_type>(                \
-            #class_name, sizeof(class_name), #member_name, &class_name::member_name); \
-        return true; }();
+// 定义成员变量并登记到编译期成员列表
+#define REFLECTABLE(class_name, member_type, member_name)                                 \
+    member_type member_name;                                                              \
+    static constexpr auto _reflectField(reflection::details::Index<REFLECT_MEMBER_COUNT_()>) \
+    {                                                                                     \
+        return reflection::Field<&class_name::member_name>{#member_name};                 \
+    }                                                                                     \
+    static reflection::details::Index<REFLECT_MEMBER_COUNT_() + 1>                        \
+        _reflectCounter(reflection::details::Rank<REFLECT_MEMBER_COUNT_() + 1>);
 
-#endif // SIMPLE_REFLECTION_REFLECTION_HPP_
\ No newline at end of file
+#endif // SIMPLE_REFLECTION_REFLECTION_HPP_
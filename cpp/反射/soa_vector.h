@@ -0,0 +1,495 @@
+#ifndef SIMPLE_REFLECTION_SOA_VECTOR_HPP_
+#define SIMPLE_REFLECTION_SOA_VECTOR_HPP_
+
+#include "reflect.h"
+
+#include <algorithm>
+#include <compare>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// 由反射成员列表生成的列式容器(structure of arrays)
+// 每个成员单独存放在一段按Alignment对齐的连续内存里，只扫描一两个字段时不会把整行拉进缓存；
+// 按行访问通过行代理，按列访问直接拿到std::span，可以写成编译器能向量化的简单循环
+namespace reflection
+{
+    namespace details
+    {
+        template <Reflectable T, size_t I>
+        using member_type_at = typename std::remove_cvref_t<decltype(std::get<I>(members_v<T>))>::member_type;
+
+        // 成员指针在成员列表中的下标
+        template <Reflectable T, auto Ptr>
+        constexpr size_t member_pointer_index()
+        {
+            size_t index = member_count_v<T>;
+            size_t i = 0;
+            for_each_member<T>([&](const auto &field)
+                               {
+                if constexpr (std::is_same_v<std::remove_const_t<decltype(field.pointer)>, decltype(Ptr)>)
+                {
+                    if (field.pointer == Ptr)
+                    {
+                        index = i;
+                    }
+                }
+                ++i; });
+            return index;
+        }
+    } // namespace details
+
+    template <Reflectable T, size_t Alignment = 64>
+    class soa_vector
+    {
+        static constexpr size_t kColumns = member_count_v<T>;
+
+        template <size_t I>
+        using column_type = details::member_type_at<T, I>;
+
+        template <auto Ptr>
+        static constexpr size_t column_index()
+        {
+            constexpr size_t index = details::member_pointer_index<T, Ptr>();
+            static_assert(index < kColumns, "member pointer is not a reflected member of T");
+            return index;
+        }
+
+        // 扩容时逐列搬移，成员移动不抛异常才能保证扩容失败时原数据不受影响
+        static constexpr bool kColumnsValid = []<size_t... I>(std::index_sequence<I...>)
+        {
+            return ((std::is_nothrow_move_constructible_v<column_type<I>> &&
+                     std::is_default_constructible_v<column_type<I>> &&
+                     alignof(column_type<I>) <= Alignment) &&
+                    ...);
+        }(std::make_index_sequence<kColumns>{});
+        static_assert(kColumnsValid, "soa_vector members must be nothrow-movable, default-constructible and fit Alignment");
+
+        using Columns = decltype([]<size_t... I>(std::index_sequence<I...>)
+                                 { return std::tuple<column_type<I> *...>{}; }(std::make_index_sequence<kColumns>{}));
+
+        template <typename Vec>
+        class basic_row;
+        template <typename Vec>
+        class basic_iterator;
+
+    public:
+        using value_type = T;
+        using size_type = size_t;
+        using reference = basic_row<soa_vector>;
+        using const_reference = basic_row<const soa_vector>;
+        using iterator = basic_iterator<soa_vector>;
+        using const_iterator = basic_iterator<const soa_vector>;
+
+        soa_vector() = default;
+
+        // 以下构造函数委托给默认构造，函数体抛异常时析构函数会释放已分配的列
+        explicit soa_vector(size_t n) : soa_vector() { resize(n); }
+
+        // 从行式存储批量转换
+        explicit soa_vector(const std::vector<T> &rows) : soa_vector() { assign(rows); }
+
+        soa_vector(const soa_vector &other) : soa_vector()
+        {
+            reserve(other._size);
+            constructRows(0, other._size, [&]<size_t I>(column_type<I> *dst)
+                          { std::uninitialized_copy_n(other.template data<I>(), other._size, dst); });
+            _size = other._size;
+        }
+
+        soa_vector(soa_vector &&other) noexcept
+            : _columns(std::exchange(other._columns, Columns{})),
+              _size(std::exchange(other._size, 0)),
+              _capacity(std::exchange(other._capacity, 0))
+        {
+        }
+
+        soa_vector &operator=(const soa_vector &other)
+        {
+            if (this != &other)
+            {
+                soa_vector copy(other);
+                swap(copy);
+            }
+            return *this;
+        }
+
+        soa_vector &operator=(soa_vector &&other) noexcept
+        {
+            soa_vector moved(std::move(other));
+            swap(moved);
+            return *this;
+        }
+
+        ~soa_vector()
+        {
+            clear();
+            deallocate(_columns);
+        }
+
+        void swap(soa_vector &other) noexcept
+        {
+            std::swap(_columns, other._columns);
+            std::swap(_size, other._size);
+            std::swap(_capacity, other._capacity);
+        }
+
+        size_t size() const { return _size; }
+        size_t capacity() const { return _capacity; }
+        bool empty() const { return _size == 0; }
+
+        void reserve(size_t n)
+        {
+            if (n > _capacity)
+            {
+                reallocate(n);
+            }
+        }
+
+        void clear()
+        {
+            forEachColumn([&]<size_t I>()
+                          { std::destroy_n(data<I>(), _size); });
+            _size = 0;
+        }
+
+        void resize(size_t n)
+        {
+            if (n < _size)
+            {
+                forEachColumn([&]<size_t I>()
+                              { std::destroy_n(data<I>() + n, _size - n); });
+            }
+            else if (n > _size)
+            {
+                reserve(n);
+                constructRows(_size, n - _size, [&]<size_t I>(column_type<I> *dst)
+                              { std::uninitialized_value_construct_n(dst, n - _size); });
+            }
+            _size = n;
+        }
+
+        void push_back(const T &value)
+        {
+            growIfFull();
+            constructRows(_size, 1, [&]<size_t I>(column_type<I> *dst)
+                          { std::construct_at(dst, std::get<I>(members_v<T>).get(value)); });
+            ++_size;
+        }
+
+        void push_back(T &&value)
+        {
+            growIfFull();
+            forEachColumn([&]<size_t I>()
+                          { std::construct_at(data<I>() + _size, std::move(std::get<I>(members_v<T>).get(value))); });
+            ++_size;
+        }
+
+        void pop_back()
+        {
+            --_size;
+            forEachColumn([&]<size_t I>()
+                          { std::destroy_at(data<I>() + _size); });
+        }
+
+        // 批量转换，按列逐段填充
+        void assign(const std::vector<T> &rows)
+        {
+            clear();
+            reserve(rows.size());
+            constructRows(0, rows.size(), [&]<size_t I>(column_type<I> *dst)
+                          {
+                size_t r = 0;
+                try
+                {
+                    for (; r < rows.size(); ++r)
+                    {
+                        std::construct_at(dst + r, std::get<I>(members_v<T>).get(rows[r]));
+                    }
+                }
+                catch (...)
+                {
+                    std::destroy_n(dst, r);
+                    throw;
+                } });
+            _size = rows.size();
+        }
+
+        std::vector<T> to_vector() const
+        {
+            std::vector<T> rows(_size);
+            forEachColumn([&]<size_t I>()
+                          {
+                const column_type<I> *column = data<I>();
+                for (size_t r = 0; r < _size; ++r)
+                {
+                    std::get<I>(members_v<T>).get(rows[r]) = column[r];
+                } });
+            return rows;
+        }
+
+        // 按行读写
+        T load(size_t i) const
+        {
+            T row{};
+            forEachColumn([&]<size_t I>()
+                          { std::get<I>(members_v<T>).get(row) = data<I>()[i]; });
+            return row;
+        }
+
+        void store(size_t i, const T &value)
+        {
+            forEachColumn([&]<size_t I>()
+                          { data<I>()[i] = std::get<I>(members_v<T>).get(value); });
+        }
+
+        reference operator[](size_t i) { return reference(this, i); }
+        const_reference operator[](size_t i) const { return const_reference(this, i); }
+
+        iterator begin() { return iterator(this, 0); }
+        iterator end() { return iterator(this, _size); }
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end() const { return const_iterator(this, _size); }
+
+        // 列访问: column<&T::member>() 或 column<I>()
+        template <auto Ptr>
+            requires std::is_member_object_pointer_v<decltype(Ptr)>
+        std::span<column_type<column_index<Ptr>()>> column()
+        {
+            return column<column_index<Ptr>()>();
+        }
+
+        template <auto Ptr>
+            requires std::is_member_object_pointer_v<decltype(Ptr)>
+        std::span<const column_type<column_index<Ptr>()>> column() const
+        {
+            return column<column_index<Ptr>()>();
+        }
+
+        template <size_t I>
+        std::span<column_type<I>> column()
+        {
+            return {data<I>(), _size};
+        }
+
+        template <size_t I>
+        std::span<const column_type<I>> column() const
+        {
+            return {data<I>(), _size};
+        }
+
+        // 列首地址，带对齐提示，便于编译器生成对齐的向量加载
+        template <size_t I>
+        column_type<I> *data()
+        {
+            return std::assume_aligned<Alignment>(std::get<I>(_columns));
+        }
+
+        template <size_t I>
+        const column_type<I> *data() const
+        {
+            return std::assume_aligned<Alignment>(std::get<I>(_columns));
+        }
+
+    private:
+        // 行代理: 持有容器指针和行号，get<&T::member>()返回列中元素的引用
+        template <typename Vec>
+        class basic_row
+        {
+        public:
+            basic_row(Vec *vec, size_t index) : _vec(vec), _index(index) {}
+
+            template <auto Ptr>
+                requires std::is_member_object_pointer_v<decltype(Ptr)>
+            decltype(auto) get() const
+            {
+                return _vec->template data<column_index<Ptr>()>()[_index];
+            }
+
+            template <size_t I>
+            decltype(auto) get() const
+            {
+                return _vec->template data<I>()[_index];
+            }
+
+            T load() const { return _vec->load(_index); }
+            operator T() const { return load(); }
+
+            const basic_row &operator=(const T &value) const
+                requires(!std::is_const_v<Vec>)
+            {
+                _vec->store(_index, value);
+                return *this;
+            }
+
+            size_t index() const { return _index; }
+
+        private:
+            Vec *_vec;
+            size_t _index;
+        };
+
+        // 行迭代器，解引用得到行代理
+        template <typename Vec>
+        class basic_iterator
+        {
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using reference = basic_row<Vec>;
+
+            basic_iterator() = default;
+            basic_iterator(Vec *vec, size_t index) : _vec(vec), _index(index) {}
+
+            reference operator*() const { return reference(_vec, _index); }
+            reference operator[](difference_type n) const { return reference(_vec, _index + n); }
+
+            basic_iterator &operator++()
+            {
+                ++_index;
+                return *this;
+            }
+            basic_iterator operator++(int) { return basic_iterator(_vec, _index++); }
+            basic_iterator &operator--()
+            {
+                --_index;
+                return *this;
+            }
+            basic_iterator operator--(int) { return basic_iterator(_vec, _index--); }
+            basic_iterator &operator+=(difference_type n)
+            {
+                _index += n;
+                return *this;
+            }
+            basic_iterator &operator-=(difference_type n)
+            {
+                _index -= n;
+                return *this;
+            }
+            friend basic_iterator operator+(basic_iterator it, difference_type n) { return it += n; }
+            friend basic_iterator operator+(difference_type n, basic_iterator it) { return it += n; }
+            friend basic_iterator operator-(basic_iterator it, difference_type n) { return it -= n; }
+            friend difference_type operator-(const basic_iterator &a, const basic_iterator &b)
+            {
+                return static_cast<difference_type>(a._index) - static_cast<difference_type>(b._index);
+            }
+            friend bool operator==(const basic_iterator &a, const basic_iterator &b) { return a._index == b._index; }
+            friend auto operator<=>(const basic_iterator &a, const basic_iterator &b) { return a._index <=> b._index; }
+
+        private:
+            Vec *_vec = nullptr;
+            size_t _index = 0;
+        };
+
+        template <typename F>
+        void forEachColumn(F &&f) const
+        {
+            [&]<size_t... I>(std::index_sequence<I...>)
+            {
+                (f.template operator()<I>(), ...);
+            }(std::make_index_sequence<kColumns>{});
+        }
+
+        // 逐列在[first, first + count)构造一行或多行，construct<I>(dst)负责一列并在失败时清理该列自己构造的部分。
+        // 后面的列抛异常时(比如拷贝std::string时bad_alloc)，前面已经构造好的列在这里销毁再重新抛出，
+        // 调用方此时还没有增加_size，容器保持原样
+        template <typename F>
+        void constructRows(size_t first, size_t count, F &&construct)
+        {
+            size_t built = 0;
+            try
+            {
+                forEachColumn([&]<size_t I>()
+                              {
+                    construct.template operator()<I>(data<I>() + first);
+                    ++built; });
+            }
+            catch (...)
+            {
+                forEachColumn([&]<size_t I>()
+                              {
+                    if (I < built)
+                    {
+                        std::destroy_n(data<I>() + first, count);
+                    } });
+                throw;
+            }
+        }
+
+        template <size_t I>
+        static column_type<I> *allocateColumn(size_t n)
+        {
+            return static_cast<column_type<I> *>(
+                ::operator new(n * sizeof(column_type<I>), std::align_val_t{Alignment}));
+        }
+
+        void deallocate(Columns &columns) const
+        {
+            forEachColumn([&]<size_t I>()
+                          {
+                if (std::get<I>(columns))
+                {
+                    ::operator delete(std::get<I>(columns), std::align_val_t{Alignment});
+                    std::get<I>(columns) = nullptr;
+                } });
+        }
+
+        void growIfFull()
+        {
+            if (_size == _capacity)
+            {
+                reallocate(std::max<size_t>(_capacity * 2, 16));
+            }
+        }
+
+        // 先分配全部新列，任何一列分配失败都回滚，然后逐列搬移
+        void reallocate(size_t capacity)
+        {
+            Columns fresh{};
+            try
+            {
+                forEachColumn([&]<size_t I>()
+                              { std::get<I>(fresh) = allocateColumn<I>(capacity); });
+            }
+            catch (...)
+            {
+                deallocate(fresh);
+                throw;
+            }
+            forEachColumn([&]<size_t I>()
+                          {
+                using M = column_type<I>;
+                M *src = std::get<I>(_columns);
+                M *dst = std::get<I>(fresh);
+                if constexpr (std::is_trivially_copyable_v<M>)
+                {
+                    if (_size != 0)
+                    {
+                        std::memcpy(dst, src, _size * sizeof(M));
+                    }
+                }
+                else
+                {
+                    std::uninitialized_move_n(src, _size, dst);
+                    std::destroy_n(src, _size);
+                } });
+            deallocate(_columns);
+            _columns = fresh;
+            _capacity = capacity;
+        }
+
+        Columns _columns{};
+        size_t _size = 0;
+        size_t _capacity = 0;
+    };
+
+} // namespace reflection
+
+#endif // SIMPLE_REFLECTION_SOA_VECTOR_HPP_
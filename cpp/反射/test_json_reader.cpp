@@ -0,0 +1,130 @@
+// json::Reader的测试: 截断和非法输入必须返回false且不读越界
+// g++ -std=c++20 -O2 test_json_reader.cpp -o test_json_reader
+#include "json_reader.h"
+#include "json_writer.h"
+
+#include <cstdio>
+#include <string>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                                           \
+    do                                                                                        \
+    {                                                                                         \
+        if (!(cond))                                                                          \
+        {                                                                                     \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);     \
+            ++failures;                                                                       \
+        }                                                                                     \
+    } while (0)
+
+struct Point
+{
+    ENABLE_REFLECT(Point)
+    REFLECTABLE(Point, int, x)
+    REFLECTABLE(Point, double, y)
+};
+
+struct Record
+{
+    ENABLE_REFLECT(Record)
+    REFLECTABLE(Record, int, a)
+    REFLECTABLE(Record, std::string, name)
+    REFLECTABLE(Record, std::vector<int>, values)
+    REFLECTABLE(Record, Point, point)
+};
+
+// 模板参数里的逗号会拆开REFLECTABLE的宏参数
+using Triple = std::array<int, 3>;
+using NamePair = std::array<std::string, 2>;
+using BoolPair = std::array<bool, 2>;
+
+struct Containers
+{
+    ENABLE_REFLECT(Containers)
+    REFLECTABLE(Containers, std::vector<bool>, flags)
+    REFLECTABLE(Containers, Triple, triple)
+    REFLECTABLE(Containers, NamePair, pair)
+    REFLECTABLE(Containers, std::vector<BoolPair>, grid)
+};
+
+// 截断在任意位置都要返回false；视图之外的字节不能被读到
+static void testTruncated()
+{
+    std::string full = R"({"a":1234567,"name":"abc","values":[1,2,3],"point":{"x":7,"y":2.5}})";
+    Record whole;
+    CHECK(reflection::fromJson(full, whole));
+    for (size_t n = 0; n < full.size(); ++n)
+    {
+        Record r;
+        CHECK(!reflection::fromJson(std::string_view(full.data(), n), r));
+    }
+
+    Record r;
+    CHECK(!reflection::fromJson(std::string_view("{\"a\":1234567", 6), r));
+    CHECK(r.a == 0);
+    CHECK(!reflection::fromJson(std::string_view("{\"a\":null}", 9), r));
+}
+
+// writeJson写出的vector<bool>和std::array能原样读回
+static void testContainersRoundTrip()
+{
+    Containers in;
+    in.flags = {true, false, false, true, true};
+    in.triple = {1, -2, 3};
+    in.pair = {"left", "right"};
+    in.grid = {{true, false}, {false, true}};
+    std::string json = reflection::toJson(in);
+    Containers out;
+    out.flags = {false};
+    CHECK(reflection::fromJson(json, out));
+    CHECK(out.flags == in.flags);
+    CHECK(out.triple == in.triple);
+    CHECK(out.pair == in.pair);
+    CHECK(out.grid == in.grid);
+    CHECK(reflection::toJson(out) == json);
+
+    // std::array的元素个数必须一致
+    CHECK(!reflection::fromJson(R"({"triple":[1,2]})", out));
+    CHECK(!reflection::fromJson(R"({"triple":[1,2,3,4]})", out));
+    CHECK(!reflection::fromJson(R"({"triple":[]})", out));
+    CHECK(reflection::fromJson(R"({"flags":[]})", out) && out.flags.empty());
+}
+
+// 根对象前后的多余内容、带转义的键、非JSON的数字写法
+static void testStrictInput()
+{
+    Point p;
+    CHECK(reflection::fromJson(" \n{\"x\":1}\t ", p) && p.x == 1);
+    CHECK(!reflection::fromJson("x{\"x\":1}", p));
+    CHECK(!reflection::fromJson("{\"x\":1}x", p));
+    CHECK(!reflection::fromJson("{\"x\":1} 5", p));
+    CHECK(!reflection::fromJson("{\"x\":1}{}", p));
+
+    CHECK(reflection::fromJson(R"({"\u0078":2})", p) && p.x == 2);
+    CHECK(reflection::fromJson(R"({"\u0079":3.5})", p) && p.y == 3.5);
+    CHECK(!reflection::fromJson(R"({"\q":2})", p));
+    p.x = 0;
+    CHECK(reflection::fromJson(R"({"x\n":9})", p) && p.x == 0);
+
+    for (const char *bad : {"inf", "-inf", "nan", "infinity", "NaN", ".5", "-.5", "+1", "-"})
+    {
+        std::string json = std::string("{\"y\":") + bad + "}";
+        CHECK(!reflection::fromJson(json, p));
+    }
+    CHECK(reflection::fromJson(R"({"y":-0.25e2})", p) && p.y == -25);
+}
+
+int main()
+{
+    testTruncated();
+    testContainersRoundTrip();
+    testStrictInput();
+    if (failures)
+    {
+        std::fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("all tests passed\n");
+    return 0;
+}
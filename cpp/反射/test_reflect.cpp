@@ -8,13 +8,10 @@ struct person
     REFLECTABLE(person, int, age)
 };
 
-// 在某个cpp文件中定义静态成员
-reflection::StructDescriptor person::Reflection("person", sizeof(person));
-
 int main()
 {
     // 打印成员数量来调试
-    std::cout << "Members count: " << person::Reflection.getMembers().size() << std::endl;
+    std::cout << "Members count: " << reflection::member_count_v<person> << std::endl;
 
     person p;
     p.name = "Alice";
@@ -0,0 +1,151 @@
+#ifndef SIMPLE_REFLECTION_TEXT_FORMAT_HPP_
+#define SIMPLE_REFLECTION_TEXT_FORMAT_HPP_
+
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMPLE_REFLECTION_SSE2 1
+#endif
+
+// 文本/JSON输出的基础格式化，直接写入输出缓冲区(BasicOutputBuffer或任何提供prepare/commit/append/push_back的类型)
+namespace reflection::text
+{
+    // 整数和浮点数，std::to_chars不分配内存且不受locale影响，浮点输出最短可往返表示
+    template <typename Buffer, typename T>
+    void writeNumber(Buffer &out, T value)
+    {
+        static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>);
+        constexpr size_t kMaxChars = 64;
+        char *p = out.prepare(kMaxChars);
+        auto result = std::to_chars(p, p + kMaxChars, value);
+        out.commit(static_cast<size_t>(result.ptr - p));
+    }
+
+    template <typename Buffer>
+    void writeBool(Buffer &out, bool value)
+    {
+        out.append(value ? std::string_view("true") : std::string_view("false"));
+    }
+
+    // JSON中需要转义的字符: 引号、反斜杠和0x20以下的控制字符
+    inline bool needsEscape(unsigned char c)
+    {
+        return c < 0x20 || c == '"' || c == '\\';
+    }
+
+    // 返回从pos开始第一个需要转义的字符的位置，没有则返回s.size()
+    // SSE2每次比较16字节，普通文本基本都走这条路径
+    inline size_t findEscape(std::string_view s, size_t pos)
+    {
+        const char *data = s.data();
+        const size_t size = s.size();
+#ifdef SIMPLE_REFLECTION_SSE2
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i control = _mm_set1_epi8(0x1f);
+        while (pos + 16 <= size)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+            // 无符号 v <= 0x1f 等价于 max(v, 0x1f) == 0x1f
+            __m128i special = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                _mm_cmpeq_epi8(_mm_max_epu8(v, control), control));
+            int mask = _mm_movemask_epi8(special);
+            if (mask != 0)
+            {
+                return pos + static_cast<size_t>(std::countr_zero(static_cast<unsigned>(mask)));
+            }
+            pos += 16;
+        }
+#endif
+        for (; pos < size; ++pos)
+        {
+            if (needsEscape(static_cast<unsigned char>(data[pos])))
+            {
+                return pos;
+            }
+        }
+        return size;
+    }
+
+    template <typename Buffer>
+    void writeEscapedChar(Buffer &out, unsigned char c)
+    {
+        switch (c)
+        {
+        case '"':
+            out.append("\\\"", 2);
+            break;
+        case '\\':
+            out.append("\\\\", 2);
+            break;
+        case '\b':
+            out.append("\\b", 2);
+            break;
+        case '\f':
+            out.append("\\f", 2);
+            break;
+        case '\n':
+            out.append("\\n", 2);
+            break;
+        case '\r':
+            out.append("\\r", 2);
+            break;
+        case '\t':
+            out.append("\\t", 2);
+            break;
+        default:
+        {
+            static constexpr char hex[] = "0123456789abcdef";
+            char escaped[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf]};
+            out.append(escaped, sizeof(escaped));
+            break;
+        }
+        }
+    }
+
+    // 带引号的JSON字符串，无需转义的片段整段拷贝
+    template <typename Buffer>
+    void writeJsonString(Buffer &out, std::string_view s)
+    {
+        out.push_back('"');
+        size_t pos = 0;
+        while (pos < s.size())
+        {
+            size_t next = findEscape(s, pos);
+            out.append(s.data() + pos, next - pos);
+            if (next == s.size())
+            {
+                break;
+            }
+            writeEscapedChar(out, static_cast<unsigned char>(s[next]));
+            pos = next + 1;
+        }
+        out.push_back('"');
+    }
+
+    // JSON数值，NaN和无穷输出null
+    template <typename Buffer, typename T>
+    void writeJsonNumber(Buffer &out, T value)
+    {
+        if constexpr (std::is_floating_point_v<T>)
+        {
+            if (!std::isfinite(value))
+            {
+                out.append("null", 4);
+                return;
+            }
+        }
+        writeNumber(out, value);
+    }
+
+} // namespace reflection::text
+
+#endif // SIMPLE_REFLECTION_TEXT_FORMAT_HPP_
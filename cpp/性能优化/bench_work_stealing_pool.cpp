@@ -0,0 +1,322 @@
+// 工作窃取线程池与单队列线程池(一把锁+条件变量，线程池优化思路.md里最初的版本)的对比
+// g++ -std=c++20 -O2 -pthread bench_work_stealing_pool.cpp -o bench_work_stealing_pool
+// ./bench_work_stealing_pool [threads=hardware_concurrency]
+// 1. fork/join: 递归fib，子任务在任务内部提交
+// 2. 细粒度任务: 外部线程一次提交大量很小的任务；以及任务内部再提交
+// 3. 混合I/O(需要asio): io_context上的定时器模拟I/O，完成后的计算放到线程池里执行，
+//    对比直接在多个线程跑io_context.run()
+#include "work_stealing_pool.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using clock_type = std::chrono::steady_clock;
+
+// 对照组: 所有线程共享一个std::function队列
+class mutex_pool {
+public:
+    explicit mutex_pool(size_t threads) {
+        for (size_t i = 0; i < threads; ++i) {
+            _threads.emplace_back([this] { run_worker(); });
+        }
+    }
+
+    ~mutex_pool() {
+        wait_idle();
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopping = true;
+        }
+        _cv.notify_all();
+        _threads.clear();
+    }
+
+    template <typename F>
+    void submit(F&& f) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _queue.emplace_back(std::forward<F>(f));
+            ++_pending;
+        }
+        _cv.notify_one();
+    }
+
+    bool try_run_one() {
+        std::function<void()> fn;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_queue.empty()) {
+                return false;
+            }
+            fn = std::move(_queue.front());
+            _queue.pop_front();
+        }
+        run(fn);
+        return true;
+    }
+
+    void wait_idle() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _idle_cv.wait(lock, [this] { return _pending == 0; });
+    }
+
+private:
+    void run_worker() {
+        for (;;) {
+            std::function<void()> fn;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _cv.wait(lock, [this] { return _stopping || !_queue.empty(); });
+                if (_queue.empty()) {
+                    return;
+                }
+                fn = std::move(_queue.front());
+                _queue.pop_front();
+            }
+            run(fn);
+        }
+    }
+
+    void run(std::function<void()>& fn) {
+        fn();
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (--_pending == 0) {
+            _idle_cv.notify_all();
+        }
+    }
+
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::condition_variable _idle_cv;
+    std::deque<std::function<void()>> _queue;
+    size_t _pending = 0;
+    bool _stopping = false;
+    std::vector<std::jthread> _threads;
+};
+
+// 和util::task_group相同的fork/join接口，用于mutex_pool
+template <typename Pool>
+class basic_group {
+public:
+    explicit basic_group(Pool& pool) : _pool(pool) {}
+    ~basic_group() { wait(); }
+
+    template <typename F>
+    void run(F&& f) {
+        _count.fetch_add(1, std::memory_order_relaxed);
+        _pool.submit([this, fn = std::forward<F>(f)]() mutable {
+            fn();
+            _count.fetch_sub(1, std::memory_order_release);
+        });
+    }
+
+    void wait() {
+        while (_count.load(std::memory_order_acquire) != 0) {
+            if (!_pool.try_run_one()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+    Pool& _pool;
+    std::atomic<size_t> _count{0};
+};
+
+template <typename Pool>
+using group_t = std::conditional_t<std::is_same_v<Pool, util::work_stealing_pool>, util::task_group, basic_group<Pool>>;
+
+template <typename F>
+double time_it(F&& f) {
+    auto start = clock_type::now();
+    f();
+    return std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+}
+
+// ---- fork/join ----
+
+long fib_serial(int n) {
+    return n < 2 ? n : fib_serial(n - 1) + fib_serial(n - 2);
+}
+
+template <typename Pool>
+long fib_parallel(Pool& pool, int n, int cutoff) {
+    if (n <= cutoff) {
+        return fib_serial(n);
+    }
+    long a = 0;
+    long b = 0;
+    {
+        group_t<Pool> group(pool);
+        group.run([&] { a = fib_parallel(pool, n - 1, cutoff); });
+        b = fib_parallel(pool, n - 2, cutoff);
+    }
+    return a + b;
+}
+
+template <typename Pool>
+void bench_fork_join(const char* name, Pool& pool, int n, int cutoff) {
+    long result = 0;
+    double ms = time_it([&] { result = fib_parallel(pool, n, cutoff); });
+    std::printf("    %-22s fib(%d) cutoff %2d = %ld  %8.2f ms\n", name, n, cutoff, result, ms);
+}
+
+// ---- 细粒度任务 ----
+
+template <typename Pool>
+void bench_external_submit(const char* name, Pool& pool, size_t tasks) {
+    std::atomic<size_t> sum{0};
+    double ms = time_it([&] {
+        for (size_t i = 0; i < tasks; ++i) {
+            pool.submit([&sum, i] { sum.fetch_add(i & 1, std::memory_order_relaxed); });
+        }
+        pool.wait_idle();
+    });
+    std::printf("    %-22s external submit   %8.2f Mtasks/s\n", name, tasks / ms / 1e3);
+}
+
+// 每个任务再提交两个子任务，形成一棵二叉树，总共2^depth-1个任务
+template <typename Pool>
+void spawn_tree(Pool& pool, std::atomic<size_t>& count, int depth) {
+    count.fetch_add(1, std::memory_order_relaxed);
+    if (depth > 1) {
+        pool.submit([&pool, &count, depth] { spawn_tree(pool, count, depth - 1); });
+        pool.submit([&pool, &count, depth] { spawn_tree(pool, count, depth - 1); });
+    }
+}
+
+template <typename Pool>
+void bench_nested_submit(const char* name, Pool& pool, int depth) {
+    std::atomic<size_t> count{0};
+    double ms = time_it([&] {
+        pool.submit([&] { spawn_tree(pool, count, depth); });
+        pool.wait_idle();
+    });
+    std::printf("    %-22s nested submit     %8.2f Mtasks/s\n", name, count.load() / ms / 1e3);
+}
+
+// ---- 混合I/O ----
+
+#ifdef WORK_STEALING_HAS_ASIO
+// 每个请求: 等一个定时器(模拟I/O) -> 一段计算 -> 再等一次 -> 再计算
+uint64_t cpu_work(uint64_t seed, int rounds) {
+    for (int i = 0; i < rounds; ++i) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+    }
+    return seed;
+}
+
+struct request_state {
+    asio::steady_timer timer;
+    uint64_t value;
+    int stage = 0;
+};
+
+// 两次计算都完成后调用finish
+template <typename Executor, typename Finish>
+void step(std::shared_ptr<request_state> req, Executor compute, int rounds, Finish finish) {
+    req->timer.expires_after(std::chrono::microseconds(200));
+    req->timer.async_wait(asio::bind_executor(compute, [req, compute, rounds, finish](const std::error_code&) {
+        req->value = cpu_work(req->value, rounds);
+        if (++req->stage < 2) {
+            step(req, compute, rounds, finish);
+        } else {
+            finish(req->value);
+        }
+    }));
+}
+
+void check_completed(const char* name, size_t completed, size_t requests) {
+    if (completed != requests) {
+        std::fprintf(stderr, "%s: only %zu of %zu requests completed\n", name, completed, requests);
+        std::exit(1);
+    }
+}
+
+void bench_mixed_io(size_t threads, size_t requests, int rounds) {
+    std::atomic<uint64_t> sink{0};
+    // io_context只负责I/O，计算在工作窃取线程池中
+    {
+        util::work_stealing_pool pool(util::work_stealing_pool::options{.threads = threads});
+        asio::io_context io;
+        // 计算在池中进行时io_context上可能没有挂起的定时器，run()会提前返回，
+        // 所以一直持有work guard，最后一个请求完成后再回到io线程释放
+        auto guard = asio::make_work_guard(io);
+        std::atomic<size_t> completed{0};
+        auto finish = [&](uint64_t value) {
+            sink.fetch_add(value & 1, std::memory_order_relaxed);
+            if (completed.fetch_add(1, std::memory_order_acq_rel) + 1 == requests) {
+                asio::post(io, [&guard] { guard.reset(); });
+            }
+        };
+        double ms = time_it([&] {
+            for (size_t i = 0; i < requests; ++i) {
+                auto req = std::make_shared<request_state>(request_state{asio::steady_timer(io), i + 1});
+                step(req, pool.get_executor(), rounds, finish);
+            }
+            io.run();
+            pool.wait_idle();
+        });
+        check_completed("io thread + ws pool", completed.load(), requests);
+        std::printf("    %-22s %8.2f ms\n", "io thread + ws pool", ms);
+    }
+    // 对照: 多个线程一起跑io_context，计算直接在完成回调里做
+    {
+        asio::io_context io;
+        std::atomic<size_t> completed{0};
+        auto finish = [&](uint64_t value) {
+            sink.fetch_add(value & 1, std::memory_order_relaxed);
+            completed.fetch_add(1, std::memory_order_relaxed);
+        };
+        double ms = time_it([&] {
+            for (size_t i = 0; i < requests; ++i) {
+                auto req = std::make_shared<request_state>(request_state{asio::steady_timer(io), i + 1});
+                step(req, io.get_executor(), rounds, finish);
+            }
+            std::vector<std::jthread> runners;
+            for (size_t i = 0; i < threads; ++i) {
+                runners.emplace_back([&io] { io.run(); });
+            }
+        });
+        check_completed("io_context x threads", completed.load(), requests);
+        std::printf("    %-22s %8.2f ms\n", "io_context x threads", ms);
+    }
+}
+#endif
+
+int main(int argc, char** argv) {
+    size_t threads = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : std::max(1u, std::thread::hardware_concurrency());
+    std::printf("threads: %zu\n", threads);
+
+    util::work_stealing_pool ws(util::work_stealing_pool::options{.threads = threads});
+    mutex_pool mp(threads);
+
+    std::printf("fork/join\n");
+    for (int cutoff : {20, 14, 10}) {
+        bench_fork_join("work_stealing_pool", ws, 32, cutoff);
+        bench_fork_join("mutex_pool", mp, 32, cutoff);
+    }
+
+    std::printf("fine-grained tasks\n");
+    bench_external_submit("work_stealing_pool", ws, 1 << 20);
+    bench_external_submit("mutex_pool", mp, 1 << 20);
+    bench_nested_submit("work_stealing_pool", ws, 20);
+    bench_nested_submit("mutex_pool", mp, 20);
+
+#ifdef WORK_STEALING_HAS_ASIO
+    std::printf("mixed I/O (10000 requests, 2 x 200us timer + compute)\n");
+    bench_mixed_io(threads, 10000, 20000);
+#else
+    std::printf("mixed I/O: asio.hpp not found, skipped\n");
+#endif
+    return 0;
+}
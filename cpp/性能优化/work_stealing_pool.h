@@ -0,0 +1,627 @@
+#ifndef WORK_STEALING_POOL_HPP_
+#define WORK_STEALING_POOL_HPP_
+// 工作窃取线程池，对应 线程池优化思路.md 里的三点:
+// 1. 降低锁粒度: 每个工作线程一个Chase-Lev双端队列，自己在底部无锁地push/pop(LIFO，缓存热)，
+//    空闲线程从随机选中的其他队列顶部窃取(FIFO，偷走的通常是较大的任务)，只有外部线程提交时经过一个带锁的注入队列
+// 2. cpu亲和性: 工作线程按顺序绑核；工作线程自己的状态(包括队列的环形数组)在绑核之后由该线程分配，
+//    按Linux的first-touch策略落在本地NUMA节点上；定义WORK_STEALING_USE_LIBNUMA并链接-lnuma时用numa_alloc_onnode显式分配。
+//    窃取时先试同一节点上的线程，再跨节点
+// 3. 没有任务时不空转: 自旋一小段后在futex上休眠(非Linux退化为std::atomic::wait)，提交任务时只在有休眠线程时才唤醒
+//
+// 另外提供task_group用于fork/join(等待时帮忙执行任务，不会因为线程都在等待而死锁)，
+// 以及在能找到asio时提供一个asio执行器适配，让io_context上的完成回调到线程池里执行
+#include "../无锁编程/concurrency_harness.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(WORK_STEALING_USE_LIBNUMA) && __has_include(<numa.h>)
+#include <numa.h>
+#define WORK_STEALING_HAS_LIBNUMA 1
+#endif
+
+#if __has_include(<asio.hpp>)
+#include <asio.hpp>
+#define WORK_STEALING_HAS_ASIO 1
+#endif
+
+namespace util {
+
+namespace detail {
+
+using concurrent::cache_line;
+using concurrent::cpu_relax;
+using harness::pin_current_thread;
+
+// ---- 休眠与唤醒 ----
+// Linux上直接用futex: 值没变时睡眠，唤醒只是一次系统调用；std::atomic::wait在libstdc++里也会走futex，
+// 但多了一层按地址哈希的等待表和自旋，其他平台上用它作为退路
+inline void futex_wait(std::atomic<uint32_t>& word, uint32_t expected) {
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+    word.wait(expected, std::memory_order_acquire);
+#endif
+}
+
+inline void futex_wake(std::atomic<uint32_t>& word, int count) {
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+#else
+    if (count == 1) {
+        word.notify_one();
+    } else {
+        word.notify_all();
+    }
+#endif
+}
+
+// ---- NUMA拓扑 ----
+
+// cpu所在的NUMA节点，拿不到拓扑信息时都算节点0
+inline int numa_node_of_cpu(unsigned cpu) {
+#if defined(WORK_STEALING_HAS_LIBNUMA)
+    if (numa_available() >= 0) {
+        int node = ::numa_node_of_cpu(static_cast<int>(cpu));
+        return node < 0 ? 0 : node;
+    }
+    return 0;
+#elif defined(__linux__)
+    // /sys/devices/system/cpu/cpuN/ 下有一个名为nodeM的链接
+    for (int node = 0; node < 64; ++node) {
+        std::ifstream probe("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/node" + std::to_string(node) + "/cpulist");
+        if (probe.is_open()) {
+            return node;
+        }
+    }
+    return 0;
+#else
+    (void)cpu;
+    return 0;
+#endif
+}
+
+// numa_alloc_onnode失败时退回new，from_numa记录实际用的是哪一个，释放时要传回free_on_node
+template <typename T, typename... Args>
+T* allocate_on_node(int node, bool& from_numa, Args&&... args) {
+    from_numa = false;
+#if defined(WORK_STEALING_HAS_LIBNUMA)
+    if (numa_available() >= 0) {
+        void* p = numa_alloc_onnode(sizeof(T), node);
+        if (p) {
+            try {
+                T* obj = new (p) T(std::forward<Args>(args)...);
+                from_numa = true;
+                return obj;
+            } catch (...) {
+                numa_free(p, sizeof(T));
+                throw;
+            }
+        }
+    }
+#endif
+    (void)node;
+    // 调用方是已绑核的工作线程，first-touch会把新页放到本地节点
+    return new T(std::forward<Args>(args)...);
+}
+
+template <typename T>
+void free_on_node(T* p, bool from_numa) {
+#if defined(WORK_STEALING_HAS_LIBNUMA)
+    if (from_numa) {
+        p->~T();
+        numa_free(p, sizeof(T));
+        return;
+    }
+#endif
+    (void)from_numa;
+    delete p;
+}
+
+// ---- 任务 ----
+// 类型擦除的任务节点，invoke执行后释放自己
+struct task {
+    void (*invoke)(task*);
+};
+
+template <typename F>
+struct task_impl final : task {
+    F fn;
+
+    explicit task_impl(F&& f) : task{&task_impl::call}, fn(std::move(f)) {}
+    explicit task_impl(const F& f) : task{&task_impl::call}, fn(f) {}
+
+    static void call(task* t) {
+        std::unique_ptr<task_impl> self(static_cast<task_impl*>(t));
+        self->fn();
+    }
+};
+
+// 入队成功之前由unique_ptr持有，入队时抛出异常也不会泄漏
+template <typename F>
+std::unique_ptr<task_impl<std::decay_t<F>>> make_task(F&& f) {
+    return std::make_unique<task_impl<std::decay_t<F>>>(std::forward<F>(f));
+}
+
+// ---- Chase-Lev双端队列 ----
+// 按 Lê, Pop, Cohen, Nardelli "Correct and Efficient Work-Stealing for Weak Memory Models" 的C11版本实现
+// 只有所有者调用push/pop，任意线程可以steal；数组满了由所有者扩容，旧数组保留到队列析构，
+// 正在读旧数组的窃取者不会访问到已释放的内存
+class chase_lev_deque {
+public:
+    explicit chase_lev_deque(size_t capacity = 1024) {
+        _arrays.push_back(std::make_unique<ring>(capacity));
+        _array.store(_arrays.back().get(), std::memory_order_relaxed);
+    }
+
+    void push(task* t) {
+        int64_t b = _bottom.load(std::memory_order_relaxed);
+        int64_t top = _top.load(std::memory_order_acquire);
+        ring* a = _array.load(std::memory_order_relaxed);
+        if (b - top > static_cast<int64_t>(a->mask)) {
+            a = grow(a, top, b);
+        }
+        a->put(b, t);
+        // 论文里是release栅栏加relaxed写；直接用release写等价，在x86上同样是一条mov，且ThreadSanitizer能识别
+        _bottom.store(b + 1, std::memory_order_release);
+    }
+
+    task* pop() {
+        int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+        ring* a = _array.load(std::memory_order_relaxed);
+        _bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = _top.load(std::memory_order_relaxed);
+        if (top > b) {
+            _bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        task* t = a->get(b);
+        if (top == b) {
+            // 最后一个元素，和窃取者竞争
+            if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                t = nullptr;
+            }
+            _bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return t;
+    }
+
+    task* steal() {
+        int64_t top = _top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = _bottom.load(std::memory_order_acquire);
+        if (top >= b) {
+            return nullptr;
+        }
+        ring* a = _array.load(std::memory_order_acquire);
+        task* t = a->get(top);
+        if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return t;
+    }
+
+    bool empty() const {
+        return _top.load(std::memory_order_relaxed) >= _bottom.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct ring {
+        size_t mask;
+        std::unique_ptr<std::atomic<task*>[]> slots;
+
+        explicit ring(size_t capacity) : mask(capacity - 1), slots(new std::atomic<task*>[capacity]) {}
+        task* get(int64_t i) const { return slots[static_cast<size_t>(i) & mask].load(std::memory_order_relaxed); }
+        void put(int64_t i, task* t) { slots[static_cast<size_t>(i) & mask].store(t, std::memory_order_relaxed); }
+    };
+
+    ring* grow(ring* old, int64_t top, int64_t b) {
+        _arrays.push_back(std::make_unique<ring>((old->mask + 1) * 2));
+        ring* a = _arrays.back().get();
+        for (int64_t i = top; i < b; ++i) {
+            a->put(i, old->get(i));
+        }
+        _array.store(a, std::memory_order_release);
+        return a;
+    }
+
+    alignas(cache_line) std::atomic<int64_t> _top{0};
+    alignas(cache_line) std::atomic<int64_t> _bottom{0};
+    alignas(cache_line) std::atomic<ring*> _array{nullptr};
+    std::vector<std::unique_ptr<ring>> _arrays; // 只有所有者访问
+};
+
+} // namespace detail
+
+class work_stealing_pool {
+public:
+    struct options {
+        size_t threads = std::max(1u, std::thread::hardware_concurrency());
+        bool pin_threads = true;
+        unsigned first_cpu = 0;    // 第i个工作线程绑定到 (first_cpu + i) % 核数
+        unsigned spin_rounds = 64; // 休眠前的空转检查次数
+    };
+
+    work_stealing_pool() : work_stealing_pool(options{}) {}
+
+    explicit work_stealing_pool(options opts) : _options(opts), _workers(std::max<size_t>(opts.threads, 1)) {
+        _threads.reserve(_workers.size());
+        unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+        for (size_t i = 0; i < _workers.size(); ++i) {
+            unsigned cpu = (_options.first_cpu + static_cast<unsigned>(i)) % cpus;
+            // 拓扑在当前线程查好再交给工作线程: libnuma第一次查询时才填充内部缓存，多个线程同时查询会竞争
+            int node = detail::numa_node_of_cpu(cpu);
+            _threads.emplace_back([this, i, cpu, node] {
+                if (_options.pin_threads) {
+                    detail::pin_current_thread(cpu);
+                }
+                bool from_numa = false;
+                _workers[i] = detail::allocate_on_node<worker>(node, from_numa, this, i, node);
+                _workers[i]->from_numa = from_numa;
+                _started.fetch_add(1, std::memory_order_release);
+                detail::futex_wake(_started, 1);
+                run_worker(*_workers[i]);
+            });
+        }
+        // 等所有工作线程分配好自己的状态
+        for (uint32_t n = _started.load(std::memory_order_acquire); n < _workers.size();
+             n = _started.load(std::memory_order_acquire)) {
+            detail::futex_wait(_started, n);
+        }
+        build_victim_order();
+    }
+
+    work_stealing_pool(const work_stealing_pool&) = delete;
+    work_stealing_pool& operator=(const work_stealing_pool&) = delete;
+
+    // 先执行完所有已提交的任务再退出
+    ~work_stealing_pool() {
+        wait_idle();
+        _stopping.store(true, std::memory_order_seq_cst);
+        _epoch.fetch_add(1, std::memory_order_release);
+        detail::futex_wake(_epoch, INT32_MAX);
+        _threads.clear();
+        for (worker* w : _workers) {
+            detail::free_on_node(w, w->from_numa);
+        }
+    }
+
+    // 工作线程里提交的任务进入自己的队列，其他线程提交的进入注入队列
+    // 任务抛出的异常和std::thread一样会导致std::terminate
+    template <typename F>
+    void submit(F&& f) {
+        // 分配任务或移动f时抛出异常直接传给调用方，这时还没有计入_pending
+        auto t = detail::make_task(std::forward<F>(f));
+        _pending.fetch_add(1, std::memory_order_relaxed);
+        worker* w = current_worker();
+        try {
+            if (w && w->pool == this) {
+                w->deque.push(t.get());
+            } else {
+                std::lock_guard<std::mutex> lock(_inject_mutex);
+                _inject.push_back(t.get());
+                _inject_size.store(_inject.size(), std::memory_order_relaxed);
+            }
+        } catch (...) {
+            // 队列扩容失败，撤销计数(可能正好归零，要唤醒wait_idle)
+            finish_one();
+            throw;
+        }
+        t.release();
+        notify_one();
+    }
+
+    // 找到一个任务就执行并返回true，给task_group等待时帮忙用，任何线程都可以调用
+    bool try_run_one() {
+        worker* w = current_worker();
+        detail::task* t = w && w->pool == this ? find_work(*w) : find_work_external();
+        if (!t) {
+            return false;
+        }
+        run(t);
+        return true;
+    }
+
+    // 等待所有已提交的任务(包括任务中再提交的)执行完
+    // 和工作线程休眠一样先登记再检查: 等待者登记后检查_pending，run在_pending归零后检查等待者
+    // 不能在本池的工作线程(即任务)里调用: 调用它的任务自己也算在_pending里，永远等不到归零；
+    // 任务里要等待子任务请用task_group
+    void wait_idle() {
+        assert(!(current_worker() && current_worker()->pool == this) && "wait_idle() called from a worker thread");
+        for (;;) {
+            uint32_t epoch = _idle_epoch.load(std::memory_order_acquire);
+            _idle_waiters.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool idle = _pending.load(std::memory_order_acquire) == 0;
+            if (!idle) {
+                detail::futex_wait(_idle_epoch, epoch);
+            }
+            _idle_waiters.fetch_sub(1, std::memory_order_relaxed);
+            if (idle) {
+                return;
+            }
+        }
+    }
+
+    size_t size() const { return _workers.size(); }
+
+    // 当前线程如果是某个池的工作线程，返回它的下标，否则返回-1
+    static int current_index() {
+        worker* w = current_worker();
+        return w ? static_cast<int>(w->index) : -1;
+    }
+
+#ifdef WORK_STEALING_HAS_ASIO
+    class executor_type;
+    executor_type get_executor() noexcept;
+#endif
+
+private:
+    struct alignas(detail::cache_line) worker {
+        work_stealing_pool* pool;
+        size_t index;
+        int node;
+        bool from_numa = false; // 由numa_alloc_onnode分配，释放时用numa_free
+        detail::chase_lev_deque deque;
+        std::vector<size_t> same_node; // 同节点的其他工作线程，优先窃取
+        std::vector<size_t> other_nodes;
+        std::minstd_rand rng;
+
+        worker(work_stealing_pool* p, size_t i, int n)
+            : pool(p), index(i), node(n), rng(static_cast<uint32_t>(i * 2654435761u + 1)) {}
+    };
+
+    static worker*& current_worker() {
+        thread_local worker* w = nullptr;
+        return w;
+    }
+
+    void build_victim_order() {
+        for (worker* w : _workers) {
+            for (worker* v : _workers) {
+                if (v != w) {
+                    (v->node == w->node ? w->same_node : w->other_nodes).push_back(v->index);
+                }
+            }
+        }
+        // 工作线程等到这里置位后才读取这两个列表
+        _victims_ready.store(1, std::memory_order_release);
+        detail::futex_wake(_victims_ready, INT32_MAX);
+    }
+
+    void run_worker(worker& self) {
+        current_worker() = &self;
+        while (_victims_ready.load(std::memory_order_acquire) == 0) {
+            detail::futex_wait(_victims_ready, 0);
+        }
+        for (;;) {
+            detail::task* t = find_work(self);
+            for (unsigned i = 0; !t && i < _options.spin_rounds; ++i) {
+                detail::cpu_relax();
+                t = find_work(self);
+            }
+            if (t) {
+                run(t);
+                continue;
+            }
+            // 准备休眠: 先登记为休眠者再最后检查一次，和notify_one里"先发布任务再检查休眠者"配对，不会丢失唤醒
+            uint32_t epoch = _epoch.load(std::memory_order_acquire);
+            _sleepers.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            t = find_work(self);
+            if (!t && !_stopping.load(std::memory_order_acquire)) {
+                detail::futex_wait(_epoch, epoch);
+            }
+            _sleepers.fetch_sub(1, std::memory_order_relaxed);
+            // 允许再发出下一次唤醒；这里之后的find_work会看到清除之前被跳过的唤醒所对应的任务
+            _waking.store(false, std::memory_order_seq_cst);
+            if (t) {
+                run(t);
+            } else if (_stopping.load(std::memory_order_acquire)) {
+                break; // 析构时已经wait_idle，这里不会丢下任务
+            }
+        }
+        current_worker() = nullptr;
+    }
+
+    void run(detail::task* t) {
+        t->invoke(t);
+        finish_one();
+    }
+
+    // 一个任务执行完或提交失败，计数归零时唤醒wait_idle
+    void finish_one() {
+        if (_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (_idle_waiters.load(std::memory_order_relaxed) > 0) {
+                _idle_epoch.fetch_add(1, std::memory_order_release);
+                detail::futex_wake(_idle_epoch, INT32_MAX);
+            }
+        }
+    }
+
+    // 同一时间只有一个唤醒在途: 被唤醒的线程还没被调度时，后续提交不再重复发起futex_wake系统调用，
+    // 它醒来找到任务后(find_work)会继续唤醒下一个
+    void notify_one() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (_sleepers.load(std::memory_order_relaxed) > 0 && !_waking.exchange(true, std::memory_order_seq_cst)) {
+            _epoch.fetch_add(1, std::memory_order_release);
+            detail::futex_wake(_epoch, 1);
+        }
+    }
+
+    detail::task* pop_inject() {
+        if (_inject_size.load(std::memory_order_relaxed) == 0) {
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(_inject_mutex);
+        if (_inject.empty()) {
+            return nullptr;
+        }
+        detail::task* t = _inject.front();
+        _inject.pop_front();
+        _inject_size.store(_inject.size(), std::memory_order_relaxed);
+        return t;
+    }
+
+    // 从随机起点遍历一组受害者
+    detail::task* steal_from(worker& self, const std::vector<size_t>& victims) {
+        if (victims.empty()) {
+            return nullptr;
+        }
+        size_t start = self.rng() % victims.size();
+        for (size_t k = 0; k < victims.size(); ++k) {
+            if (detail::task* t = _workers[victims[(start + k) % victims.size()]]->deque.steal()) {
+                return t;
+            }
+        }
+        return nullptr;
+    }
+
+    detail::task* find_work(worker& self) {
+        if (detail::task* t = self.deque.pop()) {
+            return t;
+        }
+        detail::task* t = pop_inject();
+        if (!t) {
+            t = steal_from(self, self.same_node);
+        }
+        if (!t) {
+            t = steal_from(self, self.other_nodes);
+        }
+        // 偷到了说明别处还有积压，再叫醒一个休眠的线程一起分担
+        if (t) {
+            notify_one();
+        }
+        return t;
+    }
+
+    detail::task* find_work_external() {
+        if (detail::task* t = pop_inject()) {
+            return t;
+        }
+        for (worker* w : _workers) {
+            if (detail::task* t = w->deque.steal()) {
+                return t;
+            }
+        }
+        return nullptr;
+    }
+
+    options _options;
+    std::vector<worker*> _workers;
+    std::vector<std::jthread> _threads;
+    std::atomic<uint32_t> _started{0};
+    std::atomic<uint32_t> _victims_ready{0};
+
+    alignas(detail::cache_line) std::atomic<uint32_t> _epoch{0};
+    alignas(detail::cache_line) std::atomic<uint32_t> _sleepers{0};
+    std::atomic<bool> _waking{false};
+    alignas(detail::cache_line) std::atomic<size_t> _pending{0};
+    alignas(detail::cache_line) std::atomic<uint32_t> _idle_epoch{0};
+    std::atomic<uint32_t> _idle_waiters{0};
+    alignas(detail::cache_line) std::atomic<bool> _stopping{false};
+
+    alignas(detail::cache_line) std::mutex _inject_mutex;
+    std::deque<detail::task*> _inject;
+    std::atomic<size_t> _inject_size{0};
+
+#ifdef WORK_STEALING_HAS_ASIO
+    // asio的strand等服务注册在执行器所属的execution_context上，线程池本身不是，所以带一个
+    asio::execution_context _asio_context;
+#endif
+};
+
+// fork/join: run提交子任务，wait等到它们全部完成，等待期间执行池里的任务而不是阻塞
+class task_group {
+public:
+    explicit task_group(work_stealing_pool& pool) : _pool(pool) {}
+    task_group(const task_group&) = delete;
+    task_group& operator=(const task_group&) = delete;
+    ~task_group() { wait(); }
+
+    template <typename F>
+    void run(F&& f) {
+        _count.fetch_add(1, std::memory_order_relaxed);
+        _pool.submit([this, fn = std::forward<F>(f)]() mutable {
+            fn();
+            _count.fetch_sub(1, std::memory_order_release);
+        });
+    }
+
+    // 子任务可能正被一个没轮到调度的线程执行，找不到任务帮忙时自旋一会儿就让出cpu
+    void wait() {
+        unsigned idle = 0;
+        while (_count.load(std::memory_order_acquire) != 0) {
+            if (_pool.try_run_one()) {
+                idle = 0;
+            } else if (++idle < 64) {
+                detail::cpu_relax();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+    work_stealing_pool& _pool;
+    std::atomic<size_t> _count{0};
+};
+
+#ifdef WORK_STEALING_HAS_ASIO
+// asio执行器适配: asio::post(pool.get_executor(), h)、asio::bind_executor(pool.get_executor(), h)、
+// asio::strand<work_stealing_pool::executor_type> 都可以使用
+class work_stealing_pool::executor_type {
+public:
+    explicit executor_type(work_stealing_pool& pool) noexcept : _pool(&pool) {}
+
+    template <typename F>
+    void execute(F&& f) const {
+        _pool->submit(std::forward<F>(f));
+    }
+
+    // 提交总是异步的，不会在调用线程里直接执行
+    static constexpr asio::execution::blocking_t query(asio::execution::blocking_t) noexcept {
+        return asio::execution::blocking.never;
+    }
+
+    asio::execution_context& query(asio::execution::context_t) const noexcept { return _pool->_asio_context; }
+
+    work_stealing_pool& pool() const noexcept { return *_pool; }
+
+    friend bool operator==(const executor_type& a, const executor_type& b) noexcept { return a._pool == b._pool; }
+    friend bool operator!=(const executor_type& a, const executor_type& b) noexcept { return a._pool != b._pool; }
+
+private:
+    work_stealing_pool* _pool;
+};
+
+inline work_stealing_pool::executor_type work_stealing_pool::get_executor() noexcept {
+    return executor_type(*this);
+}
+#endif
+
+} // namespace util
+
+#endif // WORK_STEALING_POOL_HPP_
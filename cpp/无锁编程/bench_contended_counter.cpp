@@ -0,0 +1,122 @@
+/**
+ * @FilePath: \note\cpp\无锁编程\bench_contended_counter.cpp
+ * @Description: 多线程竞争同一个计数器的吞吐: plain ++、atomic fetch_add、CAS循环、按线程/按核分片
+ * g++ -std=c++20 -O2 -pthread bench_contended_counter.cpp -o bench_contended_counter
+ * ./bench_contended_counter [max_threads] [increments_per_thread]
+ */
+
+// plain ++ 是 读-改-写 三步，多个核同时执行会丢失更新(而且是数据竞争)，这里只用来对照吞吐和丢失的次数；
+// fetch_add和CAS都在同一个缓存行上竞争，核数越多缓存行来回迁移越频繁；
+// per-thread每个线程写自己独占缓存行的槽位，写入不需要lock前缀，读取时把所有槽位加起来；
+// per-core按硬件线程数分片，线程数不固定时也能用，代价是每次写入仍是一次(通常无竞争的)原子RMW
+
+#include "concurrency_harness.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+using padded_counter = concurrent::padded_atomic<uint64_t>;
+
+struct plain_counter {
+	static constexpr const char* name = "plain ++";
+	alignas(harness::cache_line_size) volatile uint64_t value = 0;
+
+	explicit plain_counter(size_t) {}
+	void increment(size_t) { value = value + 1; }
+	uint64_t total() const { return value; }
+};
+
+struct fetch_add_counter {
+	static constexpr const char* name = "fetch_add";
+	padded_counter counter;
+
+	explicit fetch_add_counter(size_t) {}
+	void increment(size_t) { counter->fetch_add(1, std::memory_order_relaxed); }
+	uint64_t total() const { return counter->load(std::memory_order_relaxed); }
+};
+
+struct cas_counter {
+	static constexpr const char* name = "CAS loop";
+	padded_counter counter;
+
+	explicit cas_counter(size_t) {}
+	void increment(size_t) {
+		uint64_t expected = counter->load(std::memory_order_relaxed);
+		while (!counter->compare_exchange_weak(expected, expected + 1, std::memory_order_relaxed)) {
+			harness::cpu_relax();
+		}
+	}
+	uint64_t total() const { return counter->load(std::memory_order_relaxed); }
+};
+
+// 每个线程只写自己的槽位，单写者用load+store即可，不需要原子RMW
+struct per_thread_counter {
+	static constexpr const char* name = "per-thread";
+	std::unique_ptr<padded_counter[]> shards;
+	size_t count;
+
+	explicit per_thread_counter(size_t threads) : shards(new padded_counter[threads]), count(threads) {}
+	void increment(size_t tid) {
+		auto& v = *shards[tid];
+		v.store(v.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+	uint64_t total() const {
+		uint64_t sum = 0;
+		for (size_t i = 0; i < count; ++i) {
+			sum += shards[i]->load(std::memory_order_relaxed);
+		}
+		return sum;
+	}
+};
+
+// 按核分片(concurrent::sharded_counter): 线程数多于分片时共享分片，仍需原子RMW
+struct per_core_counter {
+	static constexpr const char* name = "per-core";
+	concurrent::sharded_counter<> counter;
+
+	explicit per_core_counter(size_t) {}
+	void increment(size_t) { counter.add(); }
+	uint64_t total() const { return static_cast<uint64_t>(counter.read()); }
+};
+
+// 耗时取最早开始到最晚结束，每个线程自己记录时间，不依赖额外的计时线程被及时调度
+template <typename Counter>
+void run(size_t threads, size_t increments) {
+	using clock = std::chrono::steady_clock;
+	Counter counter(threads);
+	harness::spin_barrier barrier(threads);
+	std::vector<clock::time_point> starts(threads), ends(threads);
+	harness::run_pinned(threads, [&](size_t tid) {
+		barrier.arrive_and_wait();
+		starts[tid] = clock::now();
+		for (size_t i = 0; i < increments; ++i) {
+			counter.increment(tid);
+		}
+		ends[tid] = clock::now();
+	});
+	auto start = *std::min_element(starts.begin(), starts.end());
+	auto end = *std::max_element(ends.begin(), ends.end());
+	double seconds = std::chrono::duration<double>(end - start).count();
+	uint64_t expected = static_cast<uint64_t>(threads) * increments;
+	uint64_t total = counter.total();
+	std::printf("  %-10s %9.1f Mops/s  %8.2f ns/op  lost %llu\n", Counter::name, expected / seconds / 1e6,
+	            seconds * 1e9 / expected, static_cast<unsigned long long>(expected - total));
+}
+
+int main(int argc, char** argv) {
+	size_t max_threads = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : harness::hardware_threads();
+	size_t increments = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000000;
+	std::printf("hardware threads: %u, increments per thread: %zu\n", harness::hardware_threads(), increments);
+	for (size_t threads = 1; threads <= max_threads; threads = threads * 2 > max_threads && threads != max_threads ? max_threads : threads * 2) {
+		std::printf("threads: %zu\n", threads);
+		run<plain_counter>(threads, increments);
+		run<fetch_add_counter>(threads, increments);
+		run<cas_counter>(threads, increments);
+		run<per_thread_counter>(threads, increments);
+		run<per_core_counter>(threads, increments);
+	}
+	return 0;
+}
@@ -0,0 +1,249 @@
+/**
+ * @FilePath: \note\cpp\无锁编程\bench_primitives.cpp
+ * @Description: concurrent_primitives.h中各原语与std::mutex实现的对比，以及填充/不填充的伪共享对比
+ * g++ -std=c++20 -O2 -pthread bench_primitives.cpp -o bench_primitives
+ * ./bench_primitives [max_threads=64] [total_ops=4000000]
+ * 线程数翻倍直到max_threads，每组的总操作数固定，平均分给各线程；结果是总吞吐(Mops/s)
+ */
+
+#include "concurrency_harness.h"
+#include "concurrent_primitives.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <queue>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+using clock_type = std::chrono::steady_clock;
+
+// 所有线程同时起跑，耗时取最早开始到最晚结束
+template <typename F>
+double run_threads(size_t threads, F&& body) {
+	harness::spin_barrier barrier(threads);
+	std::vector<clock_type::time_point> starts(threads), ends(threads);
+	harness::run_pinned(threads, [&](size_t tid) {
+		barrier.arrive_and_wait();
+		starts[tid] = clock_type::now();
+		body(tid);
+		ends[tid] = clock_type::now();
+	});
+	auto start = *std::min_element(starts.begin(), starts.end());
+	auto end = *std::max_element(ends.begin(), ends.end());
+	return std::chrono::duration<double>(end - start).count();
+}
+
+void report(const char* name, size_t ops, double seconds) {
+	std::printf("    %-26s %9.2f Mops/s\n", name, ops / seconds / 1e6);
+}
+
+// ---- 计数器 ----
+
+template <bool Padded>
+void bench_sharded_counter(size_t threads, size_t per_thread) {
+	concurrent::sharded_counter<Padded> counter;
+	double s = run_threads(threads, [&](size_t) {
+		for (size_t i = 0; i < per_thread; ++i) {
+			counter.add();
+		}
+	});
+	report(Padded ? "sharded_counter (padded)" : "sharded_counter (unpadded)", threads * per_thread, s);
+}
+
+void bench_mutex_counter(size_t threads, size_t per_thread) {
+	std::mutex m;
+	int64_t counter = 0;
+	double s = run_threads(threads, [&](size_t) {
+		for (size_t i = 0; i < per_thread; ++i) {
+			std::lock_guard<std::mutex> lock(m);
+			++counter;
+		}
+	});
+	report("std::mutex counter", threads * per_thread, s);
+}
+
+// 每个线程只写自己的槽位，没有任何逻辑上的共享；不填充时相邻槽位在同一缓存行，写入互相失效
+template <bool Padded>
+void bench_false_sharing(size_t threads, size_t per_thread) {
+	std::unique_ptr<concurrent::cell<std::atomic<int64_t>, Padded>[]> slots(
+		new concurrent::cell<std::atomic<int64_t>, Padded>[threads]);
+	double s = run_threads(threads, [&](size_t tid) {
+		auto& v = *slots[tid];
+		for (size_t i = 0; i < per_thread; ++i) {
+			v.store(v.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+	});
+	report(Padded ? "per-thread slot (padded)" : "per-thread slot (unpadded)", threads * per_thread, s);
+}
+
+// ---- 互斥锁 ----
+
+// 临界区: 更新共享的几个字段
+struct shared_state {
+	int64_t counter = 0;
+	int64_t checksum = 0;
+};
+
+template <typename Lock>
+void bench_lock(const char* name, size_t threads, size_t per_thread) {
+	Lock lock;
+	shared_state state;
+	double s = run_threads(threads, [&](size_t tid) {
+		for (size_t i = 0; i < per_thread; ++i) {
+			std::lock_guard<Lock> guard(lock);
+			++state.counter;
+			state.checksum += static_cast<int64_t>(tid);
+		}
+	});
+	if (state.counter != static_cast<int64_t>(threads * per_thread)) {
+		std::printf("    %s: lost updates!\n", name);
+	}
+	report(name, threads * per_thread, s);
+}
+
+// ---- 读写锁: 95%读 ----
+
+template <typename Lock, bool Shared>
+void bench_rw(const char* name, size_t threads, size_t per_thread) {
+	Lock lock;
+	int64_t table[8] = {};
+	std::atomic<int64_t> sink{0};
+	double s = run_threads(threads, [&](size_t tid) {
+		int64_t local = 0;
+		for (size_t i = 0; i < per_thread; ++i) {
+			if ((i + tid) % 20 == 0) {
+				std::lock_guard<Lock> guard(lock);
+				table[i & 7] += 1;
+			} else if constexpr (Shared) {
+				std::shared_lock<Lock> guard(lock);
+				for (int64_t v : table) {
+					local += v;
+				}
+			} else {
+				std::lock_guard<Lock> guard(lock);
+				for (int64_t v : table) {
+					local += v;
+				}
+			}
+		}
+		sink.fetch_add(local, std::memory_order_relaxed);
+	});
+	report(name, threads * per_thread, s);
+}
+
+// ---- 队列 ----
+
+// 对照组: 互斥锁保护的有界队列
+template <typename T>
+class mutex_queue {
+public:
+	explicit mutex_queue(size_t capacity) : capacity_(capacity) {}
+
+	bool try_push(T value) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (queue_.size() >= capacity_) {
+			return false;
+		}
+		queue_.push_back(std::move(value));
+		return true;
+	}
+
+	bool try_pop(T& out) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (queue_.empty()) {
+			return false;
+		}
+		out = std::move(queue_.front());
+		queue_.pop_front();
+		return true;
+	}
+
+private:
+	size_t capacity_;
+	std::mutex mutex_;
+	std::deque<T> queue_;
+};
+
+// 一半线程生产一半线程消费，生产者共写入items个元素，消费者取完为止
+template <typename Queue>
+void bench_queue(const char* name, size_t threads, size_t items) {
+	Queue queue(1024);
+	size_t producers = std::max<size_t>(threads / 2, 1);
+	size_t consumers = std::max<size_t>(threads - producers, 1);
+	size_t per_producer = items / producers;
+	size_t total = per_producer * producers;
+	std::atomic<size_t> consumed{0};
+	std::atomic<uint64_t> sum{0};
+	double s = run_threads(producers + consumers, [&](size_t tid) {
+		concurrent::backoff b;
+		if (tid < producers) {
+			for (size_t i = 0; i < per_producer; ++i) {
+				while (!queue.try_push(static_cast<uint64_t>(i))) {
+					b.pause();
+				}
+				b.reset();
+			}
+		} else {
+			uint64_t local = 0;
+			uint64_t value = 0;
+			while (consumed.load(std::memory_order_relaxed) < total) {
+				if (queue.try_pop(value)) {
+					local += value;
+					consumed.fetch_add(1, std::memory_order_relaxed);
+					b.reset();
+				} else {
+					b.pause();
+				}
+			}
+			sum.fetch_add(local, std::memory_order_relaxed);
+		}
+	});
+	uint64_t expected = static_cast<uint64_t>(producers) * (per_producer * (per_producer - 1) / 2);
+	if (sum.load() != expected) {
+		std::printf("    %s: checksum mismatch\n", name);
+	}
+	report(name, total, s);
+}
+
+int main(int argc, char** argv) {
+	size_t max_threads = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 64;
+	size_t total_ops = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 4000000;
+	std::printf("hardware threads: %u, cache line: %zu, total ops per run: %zu\n", harness::hardware_threads(),
+	            concurrent::cache_line, total_ops);
+
+	std::printf("spsc (1 producer, 1 consumer)\n");
+	bench_queue<concurrent::spsc_ring<uint64_t, true>>("spsc_ring (padded)", 2, total_ops);
+	bench_queue<concurrent::spsc_ring<uint64_t, false>>("spsc_ring (unpadded)", 2, total_ops);
+	bench_queue<mutex_queue<uint64_t>>("std::mutex + deque", 2, total_ops);
+
+	for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+		size_t per_thread = total_ops / threads;
+		std::printf("threads: %zu\n", threads);
+		std::printf("  counter\n");
+		bench_sharded_counter<true>(threads, per_thread);
+		bench_sharded_counter<false>(threads, per_thread);
+		bench_mutex_counter(threads, per_thread);
+		std::printf("  false sharing\n");
+		bench_false_sharing<true>(threads, per_thread);
+		bench_false_sharing<false>(threads, per_thread);
+		std::printf("  lock\n");
+		bench_lock<concurrent::spin_lock>("spin_lock (TTAS)", threads, per_thread);
+		bench_lock<concurrent::ticket_lock>("ticket_lock", threads, per_thread);
+		bench_lock<std::mutex>("std::mutex", threads, per_thread);
+		std::printf("  rw lock (95%% reads)\n");
+		bench_rw<concurrent::rw_spin_lock, true>("rw_spin_lock", threads, per_thread);
+		bench_rw<std::shared_mutex, true>("std::shared_mutex", threads, per_thread);
+		bench_rw<std::mutex, false>("std::mutex", threads, per_thread);
+		if (threads >= 2) {
+			std::printf("  mpmc (%zu producers, %zu consumers)\n", threads / 2, threads - threads / 2);
+			bench_queue<concurrent::mpmc_queue<uint64_t, true>>("mpmc_queue (padded)", threads, total_ops);
+			bench_queue<concurrent::mpmc_queue<uint64_t, false>>("mpmc_queue (unpadded)", threads, total_ops);
+			bench_queue<mutex_queue<uint64_t>>("std::mutex + deque", threads, total_ops);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,91 @@
+/**
+ * @FilePath: \note\cpp\无锁编程\concurrency_harness.h
+ * @Description: 并发测试的公共设施: 绑核、自旋屏障、按核启动线程
+ */
+#pragma once
+
+#include "concurrent_primitives.h"
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace harness {
+
+constexpr size_t cache_line_size = concurrent::cache_line;
+
+using concurrent::cpu_relax;
+
+inline unsigned hardware_threads() {
+	unsigned n = std::thread::hardware_concurrency();
+	return n ? n : 1;
+}
+
+// 把当前线程绑定到cpu上，不支持的平台返回false
+inline bool pin_current_thread(unsigned cpu) {
+	cpu %= hardware_threads();
+#if defined(_WIN32)
+	return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu) != 0;
+#elif defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	(void)cpu;
+	return false;
+#endif
+}
+
+// 反转语义的自旋屏障，所有参与者到齐后一起放行，可重复使用
+// 线程数超过核数时纯自旋会饿死还没到达的线程，这时每次检查后直接让出cpu，否则先自旋一段时间
+class spin_barrier {
+public:
+	explicit spin_barrier(size_t count)
+		: count_(count), spin_limit_(count > hardware_threads() ? 0 : 4096), waiting_(count) {}
+
+	void arrive_and_wait() {
+		bool sense = !sense_.load(std::memory_order_relaxed);
+		if (waiting_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			waiting_.store(count_, std::memory_order_relaxed);
+			sense_.store(sense, std::memory_order_release);
+			return;
+		}
+		for (unsigned spins = 0; sense_.load(std::memory_order_acquire) != sense; ++spins) {
+			if (spins < spin_limit_) {
+				cpu_relax();
+			} else {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+private:
+	const size_t count_;
+	const unsigned spin_limit_;
+	alignas(cache_line_size) std::atomic<size_t> waiting_;
+	alignas(cache_line_size) std::atomic<bool> sense_{false};
+};
+
+// 启动n个线程，第i个线程绑定到第i个cpu(超过核数时回绕)，fn(i)返回后全部join
+inline void run_pinned(size_t n, const std::function<void(size_t)>& fn) {
+	std::vector<std::jthread> threads;
+	threads.reserve(n);
+	for (size_t i = 0; i < n; ++i) {
+		threads.emplace_back([&fn, i] {
+			pin_current_thread(static_cast<unsigned>(i));
+			fn(i);
+		});
+	}
+}
+
+} // namespace harness
@@ -0,0 +1,347 @@
+/**
+ * @FilePath: \note\cpp\无锁编程\concurrent_primitives.h
+ * @Description: 按缓存行布局的并发原语: 填充的原子单元、分片计数器、SPSC环形队列、MPMC有界队列(Vyukov)、
+ *               TTAS自旋锁、票据锁、读写自旋锁
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+namespace concurrent {
+
+// 两个变量至少相隔多远才不会伪共享
+// std::hardware_destructive_interference_size的值随-mtune/-mcpu变化，用在类型布局里会让ABI随编译参数改变
+// (GCC在头文件中使用它会给出-Winterference-size警告)，所以这里按架构固定取实际的缓存行大小。
+// 这不一定等于编译器给的值: 比如GCC在aarch64上取256，是为了覆盖所有可能的核心，而常见的aarch64服务器核心是64字节，
+// Apple M系列和POWER是128字节
+#if (defined(__aarch64__) && defined(__APPLE__)) || defined(__powerpc64__)
+constexpr size_t cache_line = 128;
+#else
+constexpr size_t cache_line = 64;
+#endif
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	_mm_pause();
+#elif defined(__aarch64__)
+	asm volatile("yield");
+#endif
+}
+
+// 指数退避: 每次失败后pause的次数翻倍，到上限后改为让出cpu
+// 线程数多于核数时，持锁线程可能正等着被调度，一直自旋只会拖慢它
+class backoff {
+public:
+	void pause() {
+		if (spins_ <= max_spins) {
+			for (uint32_t i = 0; i < spins_; ++i) {
+				cpu_relax();
+			}
+			spins_ <<= 1;
+		} else {
+			std::this_thread::yield();
+		}
+	}
+	void reset() { spins_ = 1; }
+
+private:
+	static constexpr uint32_t max_spins = 1024;
+	uint32_t spins_ = 1;
+};
+
+// 独占缓存行的单元，数组里相邻元素也不会落在同一个缓存行
+template <typename T>
+struct alignas(cache_line) padded {
+	T value{};
+
+	T* operator->() { return &value; }
+	const T* operator->() const { return &value; }
+	T& operator*() { return value; }
+	const T& operator*() const { return value; }
+};
+
+// 不填充的版本，接口相同，用来对比伪共享的影响
+template <typename T>
+struct unpadded {
+	T value{};
+
+	T* operator->() { return &value; }
+	const T* operator->() const { return &value; }
+	T& operator*() { return value; }
+	const T& operator*() const { return value; }
+};
+
+template <typename T, bool Padded>
+using cell = std::conditional_t<Padded, padded<T>, unpadded<T>>;
+
+template <typename T>
+using padded_atomic = padded<std::atomic<T>>;
+
+static_assert(sizeof(padded_atomic<int>) == cache_line && alignof(padded_atomic<int>) == cache_line);
+
+// 当前线程的分片下标: 第一次使用时轮流分配，之后固定
+inline size_t thread_slot() {
+	static std::atomic<size_t> next{0};
+	thread_local size_t slot = next.fetch_add(1, std::memory_order_relaxed);
+	return slot;
+}
+
+// 分片计数器: 每个分片独占缓存行，线程按thread_slot写各自的分片，读取时求和
+// 分片数是2的幂，取硬件线程数向上取整；线程多于分片时多个线程共享一个分片，仍然正确，只是会有竞争
+template <bool Padded = true>
+class sharded_counter {
+public:
+	explicit sharded_counter(size_t shards = std::thread::hardware_concurrency())
+		: mask_(std::bit_ceil(std::max<size_t>(shards, 1)) - 1), shards_(new cell<std::atomic<int64_t>, Padded>[mask_ + 1]) {}
+
+	void add(int64_t n = 1) { shards_[thread_slot() & mask_]->fetch_add(n, std::memory_order_relaxed); }
+
+	// 不是快照: 求和期间其他线程的增量可能只被统计了一部分
+	int64_t read() const {
+		int64_t sum = 0;
+		for (size_t i = 0; i <= mask_; ++i) {
+			sum += shards_[i]->load(std::memory_order_relaxed);
+		}
+		return sum;
+	}
+
+	size_t shard_count() const { return mask_ + 1; }
+
+private:
+	size_t mask_;
+	std::unique_ptr<cell<std::atomic<int64_t>, Padded>[]> shards_;
+};
+
+// 单生产者单消费者的有界环形队列，容量向上取整到2的幂
+// 生产者和消费者各自缓存对方的下标，只有缓存的值显示满/空时才去读对方的缓存行
+template <typename T, bool Padded = true>
+class spsc_ring {
+public:
+	explicit spsc_ring(size_t capacity)
+		: mask_(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1), buffer_(new T[mask_ + 1]) {}
+
+	template <typename U>
+	bool try_push(U&& value) {
+		size_t tail = tail_->load(std::memory_order_relaxed);
+		if (tail - *head_cache_ > mask_) {
+			*head_cache_ = head_->load(std::memory_order_acquire);
+			if (tail - *head_cache_ > mask_) {
+				return false;
+			}
+		}
+		buffer_[tail & mask_] = std::forward<U>(value);
+		tail_->store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool try_pop(T& out) {
+		size_t head = head_->load(std::memory_order_relaxed);
+		if (head == *tail_cache_) {
+			*tail_cache_ = tail_->load(std::memory_order_acquire);
+			if (head == *tail_cache_) {
+				return false;
+			}
+		}
+		out = std::move(buffer_[head & mask_]);
+		head_->store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	size_t capacity() const { return mask_ + 1; }
+
+private:
+	const size_t mask_;
+	std::unique_ptr<T[]> buffer_;
+	// 消费者写head_、读tail_cache_；生产者写tail_、读head_cache_
+	cell<std::atomic<size_t>, Padded> head_;
+	cell<size_t, Padded> tail_cache_;
+	cell<std::atomic<size_t>, Padded> tail_;
+	cell<size_t, Padded> head_cache_;
+};
+
+// 多生产者多消费者的有界队列(Dmitry Vyukov的设计)
+// 每个槽位带一个序号: 序号等于入队位置时可写，等于入队位置+1时可读，读完后加上容量留给下一圈
+// 生产者之间只竞争enqueue_pos_，消费者之间只竞争dequeue_pos_，两边互不干扰
+template <typename T, bool Padded = true>
+class mpmc_queue {
+public:
+	explicit mpmc_queue(size_t capacity)
+		: mask_(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1), slots_(new slot[mask_ + 1]) {
+		for (size_t i = 0; i <= mask_; ++i) {
+			slots_[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	template <typename U>
+	bool try_push(U&& value) {
+		size_t pos = enqueue_pos_->load(std::memory_order_relaxed);
+		for (;;) {
+			slot& s = slots_[pos & mask_];
+			size_t seq = s.sequence.load(std::memory_order_acquire);
+			intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+			if (diff == 0) {
+				if (enqueue_pos_->compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					s.value = std::forward<U>(value);
+					s.sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (diff < 0) {
+				return false; // 满
+			} else {
+				pos = enqueue_pos_->load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	bool try_pop(T& out) {
+		size_t pos = dequeue_pos_->load(std::memory_order_relaxed);
+		for (;;) {
+			slot& s = slots_[pos & mask_];
+			size_t seq = s.sequence.load(std::memory_order_acquire);
+			intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+			if (diff == 0) {
+				if (dequeue_pos_->compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					out = std::move(s.value);
+					s.sequence.store(pos + mask_ + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (diff < 0) {
+				return false; // 空
+			} else {
+				pos = dequeue_pos_->load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	size_t capacity() const { return mask_ + 1; }
+
+private:
+	struct slot {
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	const size_t mask_;
+	std::unique_ptr<slot[]> slots_;
+	cell<std::atomic<size_t>, Padded> enqueue_pos_;
+	cell<std::atomic<size_t>, Padded> dequeue_pos_;
+};
+
+// test-and-test-and-set自旋锁(自旋锁.md中SpinLock的优化版本)
+// 等待时只读不写，锁字所在的缓存行可以在各核共享，释放时才失效一次；抢锁失败后指数退避
+class spin_lock {
+public:
+	void lock() {
+		backoff b;
+		while (locked_.exchange(true, std::memory_order_acquire)) {
+			while (locked_.load(std::memory_order_relaxed)) {
+				b.pause();
+			}
+		}
+	}
+
+	bool try_lock() {
+		return !locked_.load(std::memory_order_relaxed) && !locked_.exchange(true, std::memory_order_acquire);
+	}
+
+	void unlock() { locked_.store(false, std::memory_order_release); }
+
+private:
+	alignas(cache_line) std::atomic<bool> locked_{false};
+};
+
+// 票据锁(自旋锁.md中的TicketSpinLock): FIFO公平，按排在前面的人数成比例地等待
+// 严格FIFO在线程多于核数时会形成护航: 轮到的线程没被调度，后面的线程空转整个时间片也拿不到锁。
+// 所以排得太靠后、或者等了很多轮都没有前进时，改为让出cpu
+class ticket_lock {
+public:
+	void lock() {
+		uint32_t ticket = ticket_.fetch_add(1, std::memory_order_relaxed);
+		uint32_t last_position = 0;
+		uint32_t stalled = 0;
+		for (;;) {
+			uint32_t position = ticket - next_.load(std::memory_order_acquire);
+			if (position == 0) {
+				return;
+			}
+			stalled = position == last_position ? stalled + 1 : 0;
+			last_position = position;
+			if (position > max_spinning_waiters || stalled > max_stalled_rounds) {
+				std::this_thread::yield();
+				continue;
+			}
+			for (uint32_t i = 0; i < position * 32; ++i) {
+				cpu_relax();
+			}
+		}
+	}
+
+	void unlock() { next_.store(next_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+private:
+	static constexpr uint32_t max_spinning_waiters = 8;
+	static constexpr uint32_t max_stalled_rounds = 4;
+	alignas(cache_line) std::atomic<uint32_t> ticket_{0};
+	alignas(cache_line) std::atomic<uint32_t> next_{0};
+};
+
+// 读写自旋锁，写者优先: 有写者在等时新的读者不再进入，避免写者饿死
+// 状态字: 最高位表示写者持有，次高位表示有写者在等，低位是读者数
+class rw_spin_lock {
+public:
+	void lock() {
+		backoff b;
+		for (;;) {
+			uint32_t s = state_.load(std::memory_order_relaxed);
+			if ((s & ~writer_waiting) == 0) {
+				if (state_.compare_exchange_weak(s, writer, std::memory_order_acquire, std::memory_order_relaxed)) {
+					return;
+				}
+				continue;
+			}
+			if ((s & writer_waiting) == 0) {
+				state_.fetch_or(writer_waiting, std::memory_order_relaxed);
+			}
+			b.pause();
+		}
+	}
+
+	// 保留其他写者设置的等待位
+	void unlock() { state_.fetch_and(~writer, std::memory_order_release); }
+
+	void lock_shared() {
+		backoff b;
+		for (;;) {
+			uint32_t s = state_.load(std::memory_order_relaxed);
+			if ((s & (writer | writer_waiting)) == 0) {
+				if (state_.compare_exchange_weak(s, s + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+					return;
+				}
+				continue;
+			}
+			b.pause();
+		}
+	}
+
+	void unlock_shared() { state_.fetch_sub(1, std::memory_order_release); }
+
+private:
+	static constexpr uint32_t writer = 1u << 31;
+	static constexpr uint32_t writer_waiting = 1u << 30;
+	alignas(cache_line) std::atomic<uint32_t> state_{0};
+};
+
+} // namespace concurrent
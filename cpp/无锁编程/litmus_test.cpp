@@ -0,0 +1,197 @@
+/**
+ * @FilePath: \note\cpp\无锁编程\litmus_test.cpp
+ * @Description: 内存序litmus测试: SB、MP、IRIW，每个测试分别用plain、relaxed、acq_rel、seq_cst四种方式实现，
+ *               线程绑核后反复执行，统计顺序一致模型下不可能出现、但实际观察到的结果次数
+ * g++ -std=c++20 -O2 -pthread litmus_test.cpp -o litmus_test && ./litmus_test [iterations]
+ */
+
+// 预期(x86是TSO模型，只允许store-load重排):
+//   SB   plain/relaxed/acq_rel 都能观察到重排，seq_cst的store带mfence(或xchg)，观察不到
+//   MP   x86上硬件不会重排两个store或两个load，各种方式都是0；ARM/POWER上plain和relaxed可以观察到
+//   IRIW x86是多副本原子的，都是0；POWER上非seq_cst可以观察到
+// 观察不到不代表允许的行为不会发生，只说明这台机器、这个编译结果上没有出现
+// plain是volatile int: 保证编译器按代码顺序逐条发出访存指令，用来看硬件本身的行为；
+// 它在C++内存模型里是数据竞争，是未定义行为，正式代码不能这样写
+
+#include "concurrency_harness.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <type_traits>
+
+enum class mode { plain, relaxed, acq_rel, seq_cst };
+
+constexpr const char* mode_name(mode m) {
+	switch (m) {
+	case mode::plain: return "plain";
+	case mode::relaxed: return "relaxed";
+	case mode::acq_rel: return "acq_rel";
+	default: return "seq_cst";
+	}
+}
+
+constexpr std::memory_order store_order(mode m) {
+	return m == mode::relaxed ? std::memory_order_relaxed
+	     : m == mode::acq_rel ? std::memory_order_release
+	                          : std::memory_order_seq_cst;
+}
+
+constexpr std::memory_order load_order(mode m) {
+	return m == mode::relaxed ? std::memory_order_relaxed
+	     : m == mode::acq_rel ? std::memory_order_acquire
+	                          : std::memory_order_seq_cst;
+}
+
+// 一个共享变量，独占一个缓存行，避免测试变成伪共享测试
+template <mode M>
+struct alignas(harness::cache_line_size) cell {
+	std::conditional_t<M == mode::plain, volatile int, std::atomic<int>> value{0};
+
+	void store(int v) {
+		if constexpr (M == mode::plain) {
+			value = v;
+		} else {
+			value.store(v, store_order(M));
+		}
+	}
+
+	int load() {
+		if constexpr (M == mode::plain) {
+			return value;
+		} else {
+			return value.load(load_order(M));
+		}
+	}
+
+	void reset() {
+		if constexpr (M == mode::plain) {
+			value = 0;
+		} else {
+			value.store(0, std::memory_order_relaxed);
+		}
+	}
+};
+
+// store buffering: 两个线程各写一个变量再读另一个，r0=0且r1=0说明store被排到了load之后
+template <mode M>
+struct store_buffering {
+	static constexpr size_t threads = 2;
+	static constexpr const char* name = "SB";
+	static constexpr const char* outcome = "r0=0 r1=0";
+
+	cell<M> x, y;
+	int r[2] = {};
+
+	void run(size_t tid) {
+		if (tid == 0) {
+			x.store(1);
+			r[0] = y.load();
+		} else {
+			y.store(1);
+			r[1] = x.load();
+		}
+	}
+	bool observed() const { return r[0] == 0 && r[1] == 0; }
+	void reset() { x.reset(); y.reset(); }
+};
+
+// message passing: 先写数据再写标志，读到标志却读到旧数据说明store-store或load-load被重排
+template <mode M>
+struct message_passing {
+	static constexpr size_t threads = 2;
+	static constexpr const char* name = "MP";
+	static constexpr const char* outcome = "flag=1 data=0";
+
+	cell<M> data, flag;
+	int r[2] = {};
+
+	void run(size_t tid) {
+		if (tid == 0) {
+			data.store(1);
+			flag.store(1);
+		} else {
+			r[0] = flag.load();
+			r[1] = data.load();
+		}
+	}
+	bool observed() const { return r[0] == 1 && r[1] == 0; }
+	void reset() { data.reset(); flag.reset(); }
+};
+
+// independent reads of independent writes: 两个读线程以相反的顺序看到两个独立的写
+template <mode M>
+struct iriw {
+	static constexpr size_t threads = 4;
+	static constexpr const char* name = "IRIW";
+	static constexpr const char* outcome = "x,!y / y,!x";
+
+	cell<M> x, y;
+	int r[4] = {};
+
+	void run(size_t tid) {
+		switch (tid) {
+		case 0: x.store(1); break;
+		case 1: y.store(1); break;
+		case 2: r[0] = x.load(); r[1] = y.load(); break;
+		default: r[2] = y.load(); r[3] = x.load(); break;
+		}
+	}
+	bool observed() const { return r[0] == 1 && r[1] == 0 && r[2] == 1 && r[3] == 0; }
+	void reset() { x.reset(); y.reset(); }
+};
+
+// 每轮: 屏障同步起跑 -> 随机错开几个pause -> 执行 -> 屏障 -> 0号线程检查结果并复位
+template <typename Test>
+size_t run_litmus(size_t iterations) {
+	Test test;
+	harness::spin_barrier barrier(Test::threads);
+	size_t count = 0;
+	harness::run_pinned(Test::threads, [&](size_t tid) {
+		uint32_t rng = static_cast<uint32_t>(tid * 2654435761u + 1);
+		for (size_t i = 0; i < iterations; ++i) {
+			barrier.arrive_and_wait();
+			rng ^= rng << 13;
+			rng ^= rng >> 17;
+			rng ^= rng << 5;
+			for (uint32_t delay = rng & 7; delay > 0; --delay) {
+				harness::cpu_relax();
+			}
+			test.run(tid);
+			barrier.arrive_and_wait();
+			if (tid == 0) {
+				count += test.observed();
+				test.reset();
+			}
+		}
+	});
+	return count;
+}
+
+template <template <mode> class Test>
+void run_all_modes(size_t iterations) {
+	const mode modes[] = {mode::plain, mode::relaxed, mode::acq_rel, mode::seq_cst};
+	size_t counts[4] = {
+		run_litmus<Test<mode::plain>>(iterations),
+		run_litmus<Test<mode::relaxed>>(iterations),
+		run_litmus<Test<mode::acq_rel>>(iterations),
+		run_litmus<Test<mode::seq_cst>>(iterations),
+	};
+	std::printf("%-5s %-13s", Test<mode::plain>::name, Test<mode::plain>::outcome);
+	for (size_t i = 0; i < 4; ++i) {
+		std::printf("  %s %8zu", mode_name(modes[i]), counts[i]);
+	}
+	std::printf("\n");
+}
+
+int main(int argc, char** argv) {
+	size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+	std::printf("hardware threads: %u, iterations per test: %zu\n", harness::hardware_threads(), iterations);
+	if (harness::hardware_threads() < 4) {
+		std::printf("warning: fewer than 4 hardware threads, test threads share cores and rarely overlap\n");
+	}
+	run_all_modes<store_buffering>(iterations);
+	run_all_modes<message_passing>(iterations);
+	run_all_modes<iriw>(iterations);
+	return 0;
+}
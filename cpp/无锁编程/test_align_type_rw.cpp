@@ -1,4 +1,4 @@
-/** 
+/**
  * @Author: running-code-pp 3320996652@qq.com
  * @Date: 2025-10-25 20:06:28
  * @LastEditors: running-code-pp 3320996652@qq.com
@@ -9,33 +9,86 @@
  */
 
 
-// 大多数现代cpu对于自然对齐的大小小于等于内存总线宽度的数据类型的读写操作都是原子的
+// 大多数现代cpu对于自然对齐的大小小于等于内存总线宽度的数据类型的 单次读 或 单次写 是原子的:
+// 不会读到一半旧值一半新值(不会撕裂)
+// 但是这不等于 ++global_counter 是原子的:
+// 1. ++ 是 读-改-写 三步，两个核同时读到同一个旧值，各自加1再写回，就丢了一次更新
+// 2. 在C++内存模型里，多个线程不加同步地读写同一个非原子变量是数据竞争，属于未定义行为，
+//    编译器可以把循环里的 ++ 合并成一次 += 1000，也可以把读写拆开
+// 需要原子性时用std::atomic(或C++20的std::atomic_ref)，它在x86上编译成lock add，没有竞争时也只要几纳秒
+// 更完整的测试见 litmus_test.cpp(内存序) 和 bench_contended_counter.cpp(竞争计数器的吞吐)
 
+#include<atomic>
+#include<cstdint>
+#include<cstdio>
 #include<thread>
-#include<sstream>
-#include<string>
 
-std::string this_thread_id() {
-	std::ostringstream oss;
-	oss << std::this_thread::get_id();
-	return oss.str();
+constexpr int kIterations = 1000000;
+
+// 原来的循环里每次++之后都printf，一次I/O要几微秒，两个线程几乎不会同时处在 读-改-写 之间，
+// 结果常常"恰好"是2000，测的其实是printf的速度。去掉I/O、加大次数后丢失更新就很明显了
+// volatile只是让编译器老老实实每次都读写内存，它不提供原子性，也不消除数据竞争
+volatile int global_counter = 0;
+
+void plain_increment() {
+	for (int i = 0; i < kIterations; i++) {
+		global_counter = global_counter + 1;
+	}
 }
-int global_counter = 0;
 
-// 这里的操作是原子性的,最终的global_counter符合预期结果2000
-void thread_func() {
-	for(int i=0;i<1000;i++) {
-		++global_counter;
-		printf("thread-%s,global_counter:%d\n",this_thread_id().c_str(),global_counter);
+void test_plain_increment() {
+	global_counter = 0;
+	{
+		std::jthread t1(plain_increment);
+		std::jthread t2(plain_increment);
 	}
+	std::printf("plain ++:      %d / %d (lost %d)\n", global_counter, 2 * kIterations, 2 * kIterations - global_counter);
 }
 
-void test_global_int_rw() {
-	std::jthread t1(thread_func);
-	std::jthread t2(thread_func);
+std::atomic<int> atomic_counter{0};
+
+void atomic_increment() {
+	for (int i = 0; i < kIterations; i++) {
+		atomic_counter.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void test_atomic_increment() {
+	atomic_counter = 0;
+	{
+		std::jthread t1(atomic_increment);
+		std::jthread t2(atomic_increment);
+	}
+	std::printf("atomic ++:     %d / %d\n", atomic_counter.load(), 2 * kIterations);
+}
+
+// 对齐的8字节读写不会撕裂: 写线程交替写入全0和全1，读线程只会看到这两个值之一
+// relaxed原子读写在x86-64上就是普通的mov，这正是原来那句话真正成立的部分
+std::atomic<uint64_t> shared_word{0};
+
+void test_aligned_no_tearing() {
+	std::atomic<bool> stop{false};
+	uint64_t torn = 0;
+	{
+		std::jthread writer([&] {
+			for (int i = 0; i < kIterations; i++) {
+				shared_word.store(i & 1 ? ~uint64_t(0) : 0, std::memory_order_relaxed);
+			}
+			stop.store(true, std::memory_order_relaxed);
+		});
+		std::jthread reader([&] {
+			while (!stop.load(std::memory_order_relaxed)) {
+				uint64_t v = shared_word.load(std::memory_order_relaxed);
+				torn += v != 0 && v != ~uint64_t(0);
+			}
+		});
+	}
+	std::printf("aligned 8-byte store/load: torn reads %llu\n", static_cast<unsigned long long>(torn));
 }
 
 int main() {
-    test_global_int_rw();
-    return 0;
-}
\ No newline at end of file
+	test_plain_increment();
+	test_atomic_increment();
+	test_aligned_no_tearing();
+	return 0;
+}
@@ -0,0 +1,251 @@
+#ifndef REQUEST_TRACE_H_
+#define REQUEST_TRACE_H_
+
+// 请求级别的轻量事件追踪
+// - 每个线程一个固定大小的二进制环形缓冲区，写入时无锁、无分配
+// - 时间戳直接读TSC，导出时用steady_clock做校准换算成微秒
+// - 运行时开关，关闭时每个埋点只有一次relaxed load加一个可预测分支
+// - 按需导出为Chrome trace / Perfetto 可识别的JSON (chrome://tracing 或 ui.perfetto.dev 打开)
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define REQUEST_TRACE_HAS_TSC 1
+#endif
+
+namespace trace {
+
+// 请求经过的各个阶段
+enum class Stage : uint16_t {
+    REQUEST,        // Client::send_request 整个生命周期
+    STRAND_HOP,     // get_connection 投递到strand到真正执行
+    POOL_WAIT,      // 在 waiting_handlers_ 中排队
+    HANDOFF,        // 拿到连接后投递回io_context到handler执行
+    CONNECT,        // Connection::connect 整体(含重连)
+    RESOLVE,        // 域名解析
+    TCP_CONNECT,    // async_connect
+    TLS_HANDSHAKE,  // TLS握手(完整或会话复用)
+    WRITE,          // 写请求
+    READ,           // 读响应
+    HEALTH_CHECK,   // 健康检查
+    POOL_HIT,       // 瞬时事件:直接命中空闲连接
+    RECONNECT,      // 瞬时事件:连接失败后安排重连
+    STAGE_COUNT
+};
+
+// 事件类型，取值与Chrome trace的异步事件ph字段对应
+enum class Phase : char {
+    BEGIN = 'b',
+    END = 'e',
+    INSTANT = 'n'
+};
+
+inline const char* stage_name(Stage stage) {
+    static constexpr const char* names[] = {
+        "request", "strand_hop", "pool_wait", "handoff", "connect", "resolve",
+        "tcp_connect", "tls_handshake", "write", "read", "health_check", "pool_hit", "reconnect"
+    };
+    static_assert(std::size(names) == static_cast<size_t>(Stage::STAGE_COUNT));
+    return names[static_cast<size_t>(stage)];
+}
+
+// 环形缓冲区中的一条记录，固定16字节
+struct Event {
+    uint64_t tsc;     // 时间戳计数
+    uint32_t id;      // 请求或连接的追踪id，截断到32位，足够区分一次dump窗口内的请求
+    Stage stage;
+    Phase phase;
+    uint8_t reserved;
+};
+static_assert(sizeof(Event) == 16, "trace event should stay compact");
+
+namespace detail {
+
+inline uint64_t read_tsc() {
+#ifdef REQUEST_TRACE_HAS_TSC
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// 单线程写、dump时多线程读的环形缓冲区，写满后覆盖最旧的记录
+struct ThreadRing {
+    static constexpr size_t kCapacity = 1 << 14;
+    static constexpr size_t kMask = kCapacity - 1;
+
+    explicit ThreadRing(uint32_t t) : tid(t) {}
+
+    void push(const Event& ev) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        events[h & kMask] = ev;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    std::array<Event, kCapacity> events{};
+    std::atomic<uint64_t> head{0};
+    const uint32_t tid;
+};
+
+// 全局状态:开关、线程缓冲区注册表、TSC校准基准
+struct Registry {
+    std::atomic<bool> enabled{false};
+    std::atomic<uint32_t> next_id{1};
+
+    std::mutex mutex; // 只在线程首次写入注册缓冲区和dump时使用
+    std::vector<std::shared_ptr<ThreadRing>> rings;
+
+    uint64_t base_tsc = 0;
+    std::chrono::steady_clock::time_point base_time;
+
+    static Registry& instance() {
+        static Registry registry;
+        return registry;
+    }
+};
+
+inline ThreadRing& local_ring() {
+    // 缓冲区由注册表共同持有，线程退出后记录仍可导出
+    thread_local std::shared_ptr<ThreadRing> ring = [] {
+        auto& reg = Registry::instance();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        auto r = std::make_shared<ThreadRing>(static_cast<uint32_t>(reg.rings.size() + 1));
+        reg.rings.push_back(r);
+        return r;
+    }();
+    return *ring;
+}
+
+// 计算每微秒的tsc tick数；基准点在enable()时记录，窗口太短时额外采样一小段时间
+// 采样期间会忙等10ms，不要在持有reg.mutex时调用，否则新线程首次写入都会被挡住
+inline double ticks_per_us(uint64_t base_tsc, std::chrono::steady_clock::time_point base_time) {
+    using namespace std::chrono;
+    auto now = steady_clock::now();
+    uint64_t tsc = read_tsc();
+    auto elapsed = duration_cast<nanoseconds>(now - base_time).count();
+    if (elapsed < 10'000'000) {
+        auto start = steady_clock::now();
+        uint64_t start_tsc = read_tsc();
+        while (steady_clock::now() - start < milliseconds(10)) {
+        }
+        now = steady_clock::now();
+        tsc = read_tsc();
+        elapsed = duration_cast<nanoseconds>(now - start).count();
+        return static_cast<double>(tsc - start_tsc) * 1000.0 / static_cast<double>(elapsed);
+    }
+    return static_cast<double>(tsc - base_tsc) * 1000.0 / static_cast<double>(elapsed);
+}
+
+} // namespace detail
+
+// 运行时开关
+inline void enable(bool on = true) {
+    auto& reg = detail::Registry::instance();
+    if (on && !reg.enabled.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.base_time = std::chrono::steady_clock::now();
+        reg.base_tsc = detail::read_tsc();
+    }
+    reg.enabled.store(on, std::memory_order_relaxed);
+}
+
+inline bool enabled() {
+    return detail::Registry::instance().enabled.load(std::memory_order_relaxed);
+}
+
+// 为一次请求或一条连接分配追踪id，关闭时返回0
+inline uint32_t new_id() {
+    if (!enabled()) {
+        return 0;
+    }
+    return detail::Registry::instance().next_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+// 埋点，id为0(追踪开启前创建的请求)时直接忽略
+inline void record(Stage stage, Phase phase, uint32_t id) {
+    if (!enabled() || id == 0) [[likely]] {
+        return;
+    }
+    detail::local_ring().push(Event{detail::read_tsc(), id, stage, phase, 0});
+}
+
+inline void begin(Stage stage, uint32_t id) { record(stage, Phase::BEGIN, id); }
+inline void end(Stage stage, uint32_t id) { record(stage, Phase::END, id); }
+inline void instant(Stage stage, uint32_t id) { record(stage, Phase::INSTANT, id); }
+
+// 导出所有线程缓冲区中的事件为Chrome trace JSON
+// 使用异步事件(b/e/n)并以追踪id分组，这样跨线程的阶段也能拼成一条请求时间线
+// 导出时写线程不必停下：复制后会丢弃在复制过程中可能被覆盖的最旧记录
+inline void dump_chrome_trace(std::ostream& os) {
+    auto& reg = detail::Registry::instance();
+    std::vector<std::shared_ptr<detail::ThreadRing>> rings;
+    uint64_t base_tsc;
+    std::chrono::steady_clock::time_point base_time;
+    {
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        rings = reg.rings;
+        base_tsc = reg.base_tsc;
+        base_time = reg.base_time;
+    }
+    double tpu = detail::ticks_per_us(base_tsc, base_time);
+
+    os << "{\"traceEvents\":[";
+    bool first = true;
+    std::vector<Event> snapshot;
+    for (const auto& ring : rings) {
+        uint64_t h = ring->head.load(std::memory_order_acquire);
+        uint64_t begin_index = h > detail::ThreadRing::kCapacity ? h - detail::ThreadRing::kCapacity : 0;
+        snapshot.clear();
+        for (uint64_t i = begin_index; i < h; ++i) {
+            snapshot.push_back(ring->events[i & detail::ThreadRing::kMask]);
+        }
+        // 复制期间被写线程追上覆盖的槽位不可信，丢弃；写线程此刻可能正在写下标h_after，
+        // 它和h_after - kCapacity是同一个槽，所以这一条也要丢掉
+        uint64_t h_after = ring->head.load(std::memory_order_acquire);
+        uint64_t valid_from =
+            h_after + 1 > detail::ThreadRing::kCapacity ? h_after + 1 - detail::ThreadRing::kCapacity : 0;
+        size_t skip = valid_from > begin_index ? static_cast<size_t>(valid_from - begin_index) : 0;
+
+        for (size_t i = skip; i < snapshot.size(); ++i) {
+            const Event& ev = snapshot[i];
+            if (ev.tsc < base_tsc) {
+                continue; // 上一次enable之前的记录
+            }
+            double ts = static_cast<double>(ev.tsc - base_tsc) / tpu;
+            os << (first ? "" : ",") << "\n{\"name\":\"" << stage_name(ev.stage)
+               << "\",\"cat\":\"pool\",\"ph\":\"" << static_cast<char>(ev.phase)
+               << "\",\"id\":" << ev.id << ",\"ts\":" << std::fixed << ts
+               << ",\"pid\":1,\"tid\":" << ring->tid << "}";
+            first = false;
+        }
+    }
+    os << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+inline bool dump_chrome_trace(const std::string& path) {
+    std::ofstream ofs(path);
+    if (!ofs.is_open()) {
+        return false;
+    }
+    dump_chrome_trace(ofs);
+    return static_cast<bool>(ofs);
+}
+
+} // namespace trace
+
+#endif // REQUEST_TRACE_H_
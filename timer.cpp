@@ -1,12 +1,19 @@
 #include <asio.hpp>
+#include <asio/ssl.hpp>
 #include <string>
 #include <vector>
-#include <queue>
+#include <deque>
+#include <algorithm>
 #include <memory>
 #include <mutex>
 #include <functional>
 #include <iostream>
+#include <sstream>
 #include <chrono>
+#include <atomic>
+#include <unordered_map>
+
+#include "request_trace.h"
 
 // 前向声明
 class Connection; 
@@ -20,6 +27,132 @@ struct ConnectionPoolConfig {
     std::chrono::seconds connection_timeout = std::chrono::seconds(5);  // 连接超时时间
     std::chrono::seconds idle_timeout = std::chrono::seconds(60);       // 空闲连接超时
     std::chrono::seconds health_check_interval = std::chrono::seconds(30); // 健康检查间隔
+
+    // TLS配置，ssl_context为空时使用明文TCP
+    // 整个连接池共享同一个ssl::context，连接池会在其上注册客户端会话缓存回调
+    std::shared_ptr<asio::ssl::context> ssl_context;
+    std::string tls_server_name;   // SNI及证书校验使用的主机名，为空时使用host
+    size_t prewarm_spare = 0;      // 预热:在使用中的连接之外额外保持的空闲/握手中连接数，把握手挪出请求路径
+};
+
+// TLS握手统计
+struct TlsStats {
+    uint64_t full_handshakes = 0;     // 完整握手次数
+    uint64_t resumed_handshakes = 0;  // 会话复用握手次数
+    uint64_t failed_handshakes = 0;   // 握手失败次数
+    std::chrono::nanoseconds handshake_time{0}; // 握手累计耗时
+};
+
+// 连接池共享的TLS状态:ssl::context、按服务端端点索引的会话票据缓存、握手统计
+// 重连(handle_connect_error)和连接池扩容时优先用缓存的会话做简短握手，避免每次都走完整握手
+class TlsContext {
+public:
+    using Ptr = std::shared_ptr<TlsContext>;
+
+    // 挂在每个SSL对象上的ex_data，会话票据到达时据此找到缓存和端点
+    struct SessionSlot {
+        TlsContext* tls = nullptr;
+        std::string endpoint;
+        bool ticket_received = false;
+        std::function<void()> on_ticket; // 票据到达时调用(在OpenSSL处理读取的过程中，不能在里面直接操作socket)
+    };
+
+    TlsContext(std::shared_ptr<asio::ssl::context> context, std::string server_name)
+        : context_(std::move(context)), server_name_(std::move(server_name)) {
+        // TLS1.3的会话票据在握手完成之后才由服务端发送，所以用new_session回调收集，
+        // 而不是在握手完成时调用SSL_get1_session；内部缓存对客户端没用，关掉
+        SSL_CTX* native = context_->native_handle();
+        SSL_CTX_set_session_cache_mode(native, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(native, &TlsContext::on_new_session);
+    }
+
+    ~TlsContext() {
+        for (auto& [endpoint, session] : sessions_) {
+            SSL_SESSION_free(session);
+        }
+    }
+
+    asio::ssl::context& context() { return *context_; }
+    const std::string& server_name() const { return server_name_; }
+
+    static int slot_index() {
+        static const int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+        return index;
+    }
+
+    // 取出端点对应的会话(增加引用计数，调用方负责释放)，没有则返回nullptr
+    SSL_SESSION* acquire_session(const std::string& endpoint) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = sessions_.find(endpoint);
+        if (it == sessions_.end()) {
+            return nullptr;
+        }
+        SSL_SESSION_up_ref(it->second);
+        return it->second;
+    }
+
+    // 握手失败时丢弃该端点的会话，下次走完整握手
+    void drop_session(const std::string& endpoint) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = sessions_.find(endpoint);
+        if (it != sessions_.end()) {
+            SSL_SESSION_free(it->second);
+            sessions_.erase(it);
+        }
+    }
+
+    void record_handshake(bool success, bool resumed, std::chrono::nanoseconds cost) {
+        if (!success) {
+            failed_handshakes_.fetch_add(1, std::memory_order_relaxed);
+        } else if (resumed) {
+            resumed_handshakes_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            full_handshakes_.fetch_add(1, std::memory_order_relaxed);
+        }
+        handshake_ns_.fetch_add(static_cast<uint64_t>(cost.count()), std::memory_order_relaxed);
+    }
+
+    TlsStats stats() const {
+        TlsStats s;
+        s.full_handshakes = full_handshakes_.load(std::memory_order_relaxed);
+        s.resumed_handshakes = resumed_handshakes_.load(std::memory_order_relaxed);
+        s.failed_handshakes = failed_handshakes_.load(std::memory_order_relaxed);
+        s.handshake_time = std::chrono::nanoseconds(handshake_ns_.load(std::memory_order_relaxed));
+        return s;
+    }
+
+private:
+    // OpenSSL收到新会话(票据)时回调，返回1表示接管session的引用
+    static int on_new_session(SSL* ssl, SSL_SESSION* session) {
+        auto* slot = static_cast<SessionSlot*>(SSL_get_ex_data(ssl, slot_index()));
+        if (!slot || !slot->tls) {
+            return 0;
+        }
+        {
+            std::lock_guard<std::mutex> lock(slot->tls->mutex_);
+            auto& cached = slot->tls->sessions_[slot->endpoint];
+            if (cached) {
+                SSL_SESSION_free(cached);
+            }
+            cached = session;
+        }
+        slot->ticket_received = true;
+        if (slot->on_ticket) {
+            slot->on_ticket();
+        }
+        return 1;
+    }
+
+    std::shared_ptr<asio::ssl::context> context_;
+    std::string server_name_;
+
+    std::mutex mutex_; // 连接可能在多个io线程上完成握手
+    std::unordered_map<std::string, SSL_SESSION*> sessions_;
+
+    std::atomic<uint64_t> full_handshakes_{0};
+    std::atomic<uint64_t> resumed_handshakes_{0};
+    std::atomic<uint64_t> failed_handshakes_{0};
+    std::atomic<uint64_t> handshake_ns_{0};
 };
 
 // 连接状态枚举
@@ -39,9 +172,13 @@ public:
     using ConnectCallback = std::function<void(bool, Connection::Ptr)>;
     using HealthCheckCallback = std::function<void(bool)>;
 
-    Connection(asio::io_context& io_context, const std::string& host, const std::string& port)
+    // tls为空时是明文TCP连接，否则在TCP连接建立后做TLS握手
+    Connection(asio::io_context& io_context, const std::string& host, const std::string& port,
+               TlsContext::Ptr tls = nullptr)
         : socket_(io_context),
           resolver_(io_context),
+          tls_(std::move(tls)),
+          ticket_timer_(io_context),
           host_(host),
           port_(port),
           status_(ConnectionStatus::DISCONNECTED),
@@ -55,7 +192,9 @@ public:
     }
 
     // 连接到服务器
-    void connect(ConnectCallback callback, const std::chrono::seconds& timeout = std::chrono::seconds(5)) {
+    // trace_id: 追踪id，连接为某个请求而建时传入请求的id，让连接阶段出现在该请求的时间线上
+    void connect(ConnectCallback callback, const std::chrono::seconds& timeout = std::chrono::seconds(5),
+                 uint32_t trace_id = 0) {
         if (status_ != ConnectionStatus::DISCONNECTED) {
             callback(false, shared_from_this());
             return;
@@ -63,13 +202,20 @@ public:
 
         status_ = ConnectionStatus::CONNECTING;
         reconnect_attempts_ = 0;
+        trace_id_ = trace_id;
+        uint32_t generation = ++connect_generation_;
 
-        // 设置连接超时定时器
+        // 设置连接超时定时器，覆盖解析、TCP连接、TLS握手和等待会话票据的全过程
         timeout_timer_ = std::make_unique<asio::steady_timer>(socket_.get_executor(), timeout);
-        timeout_timer_->async_wait([this, self = shared_from_this()](const asio::error_code& ec) {
-            if (!ec && status_ == ConnectionStatus::CONNECTING) {
-                // 连接超时
+        timeout_timer_->async_wait([this, self = shared_from_this(), generation](const asio::error_code& ec) {
+            if (!ec && generation == connect_generation_ && status_ == ConnectionStatus::CONNECTING) {
+                // 连接超时: 作废这次连接尝试，关闭socket让挂起的操作以operation_aborted结束，
+                // 它们看到代数变了直接返回，回调只在这里调用一次
                 std::cerr << "Connection timeout to " << host_ << ":" << port_ << std::endl;
+                ++connect_generation_;
+                resolver_.cancel();
+                asio::error_code ignored;
+                socket_.close(ignored);
                 status_ = ConnectionStatus::DISCONNECTED;
                 if (connect_callback_) {
                     connect_callback_(false, self);
@@ -79,33 +225,38 @@ public:
 
         connect_callback_ = std::move(callback);
 
-        resolver_.async_resolve(host_, port_, [this, self = shared_from_this()](
+        trace::begin(trace::Stage::RESOLVE, trace_id_);
+        resolver_.async_resolve(host_, port_, [this, self = shared_from_this(), generation](
             const asio::error_code& ec, asio::ip::tcp::resolver::results_type results) {
+            trace::end(trace::Stage::RESOLVE, trace_id_);
+            if (generation != connect_generation_) {
+                return;
+            }
             if (ec) {
                 handle_connect_error(ec);
                 return;
             }
 
-            asio::async_connect(socket_, results, [this, self = shared_from_this()](
+            trace::begin(trace::Stage::TCP_CONNECT, trace_id_);
+            asio::async_connect(socket_, results, [this, self = shared_from_this(), generation](
                 const asio::error_code& ec, const asio::ip::tcp::endpoint& endpoint) {
-                // 取消超时定时器
-                if (timeout_timer_) {
-                    timeout_timer_->cancel();
+                trace::end(trace::Stage::TCP_CONNECT, trace_id_);
+                if (generation != connect_generation_) {
+                    return;
                 }
-
                 if (ec) {
+                    if (timeout_timer_) {
+                        timeout_timer_->cancel();
+                    }
                     handle_connect_error(ec);
                     return;
                 }
 
-                // 连接成功
-                status_ = ConnectionStatus::CONNECTED;
-                last_activity_ = std::chrono::steady_clock::now();
-                std::cout << "Connected to " << endpoint << std::endl;
-                
-                if (connect_callback_) {
-                    connect_callback_(true, self);
+                if (tls_) {
+                    start_handshake(endpoint, generation);
+                    return;
                 }
+                on_connected(endpoint);
             });
         });
     }
@@ -121,13 +272,18 @@ public:
         }
 
         last_activity_ = std::chrono::steady_clock::now();
-        asio::async_write(socket_, buffers, [this, handler = std::move(handler)](
+        auto on_complete = [this, handler = std::move(handler)](
             const asio::error_code& ec, size_t bytes_transferred) {
             if (ec) {
                 handle_io_error(ec);
             }
             handler(ec, bytes_transferred);
-        });
+        };
+        if (tls_stream_) {
+            asio::async_write(*tls_stream_, buffers, std::move(on_complete));
+        } else {
+            asio::async_write(socket_, buffers, std::move(on_complete));
+        }
     }
 
     // 异步读取数据
@@ -141,13 +297,28 @@ public:
         }
 
         last_activity_ = std::chrono::steady_clock::now();
-        socket_.async_read_some(buffers, [this, handler = std::move(handler)](
+        if (prefetch_size_ > 0) {
+            // 先交出等待会话票据时顺带读到的应用数据
+            size_t n = asio::buffer_copy(buffers, asio::buffer(prefetch_buffer_.data(), prefetch_size_));
+            prefetch_buffer_.erase(prefetch_buffer_.begin(), prefetch_buffer_.begin() + n);
+            prefetch_size_ -= n;
+            asio::post(socket_.get_executor(), [handler, n]() {
+                handler(asio::error_code(), n);
+            });
+            return;
+        }
+        auto on_complete = [this, handler = std::move(handler)](
             const asio::error_code& ec, size_t bytes_transferred) {
             if (ec) {
                 handle_io_error(ec);
             }
             handler(ec, bytes_transferred);
-        });
+        };
+        if (tls_stream_) {
+            tls_stream_->async_read_some(buffers, std::move(on_complete));
+        } else {
+            socket_.async_read_some(buffers, std::move(on_complete));
+        }
     }
 
     // 关闭连接
@@ -157,6 +328,12 @@ public:
         }
 
         status_ = ConnectionStatus::CLOSING;
+
+        if (tls_stream_) {
+            // 标记为已发送close_notify，否则SSL_free会把会话标记为不可复用，缓存里的票据就作废了
+            // 这里是同步关闭，不等待对端的close_notify
+            SSL_set_shutdown(tls_stream_->native_handle(), SSL_SENT_SHUTDOWN);
+        }
         
         asio::error_code ec;
         socket_.shutdown(asio::ip::tcp::socket::shutdown_both, ec);
@@ -190,13 +367,17 @@ public:
         }
 
         status_ = ConnectionStatus::HEALTH_CHECKING;
+        // 健康检查不属于任何请求，用新的id，不能沿用建连时请求的trace_id_，否则会落到那个请求的时间线上
+        uint32_t check_id = trace::new_id();
+        trace::begin(trace::Stage::HEALTH_CHECK, check_id);
 
         // 在实际应用中，这里应该发送一个简单的健康检查请求
         // 这里只是模拟一个快速的检查
-        asio::post(socket_.get_executor(), [this, self = shared_from_this(), callback = std::move(callback)]() {
+        asio::post(socket_.get_executor(), [this, self = shared_from_this(), callback = std::move(callback), check_id]() {
             // 假设检查总是成功的
             // 在真实场景中，应该发送一个ping或其他简单请求
             status_ = ConnectionStatus::CONNECTED;
+            trace::end(trace::Stage::HEALTH_CHECK, check_id);
             callback(true);
         });
     }
@@ -212,6 +393,126 @@ public:
     }
 
 private:
+    // TCP连接建立后进行TLS握手，有该端点的缓存会话时尝试复用
+    void start_handshake(const asio::ip::tcp::endpoint& endpoint, uint32_t generation) {
+        // 每次连接都用新的SSL对象，旧的SSL状态不能跨TCP连接复用
+        tls_stream_ = std::make_unique<asio::ssl::stream<asio::ip::tcp::socket&>>(socket_, tls_->context());
+        SSL* ssl = tls_stream_->native_handle();
+
+        std::ostringstream key;
+        key << endpoint;
+        session_slot_.tls = tls_.get();
+        session_slot_.endpoint = key.str();
+        session_slot_.ticket_received = false;
+        session_slot_.on_ticket = nullptr;
+        SSL_set_ex_data(ssl, TlsContext::slot_index(), &session_slot_);
+
+        const std::string& server_name = tls_->server_name().empty() ? host_ : tls_->server_name();
+        SSL_set_tlsext_host_name(ssl, server_name.c_str());
+        tls_stream_->set_verify_callback(asio::ssl::host_name_verification(server_name));
+
+        if (SSL_SESSION* session = tls_->acquire_session(session_slot_.endpoint)) {
+            SSL_set_session(ssl, session);
+            SSL_SESSION_free(session);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        trace::begin(trace::Stage::TLS_HANDSHAKE, trace_id_);
+        tls_stream_->async_handshake(asio::ssl::stream_base::client,
+            [this, self = shared_from_this(), endpoint, start, generation](const asio::error_code& ec) {
+                trace::end(trace::Stage::TLS_HANDSHAKE, trace_id_);
+                auto cost = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start);
+                if (generation != connect_generation_) {
+                    // 已经超时，socket已关闭
+                    tls_stream_.reset();
+                    return;
+                }
+
+                if (ec) {
+                    tls_->record_handshake(false, false, cost);
+                    tls_->drop_session(session_slot_.endpoint);
+                    tls_stream_.reset();
+                    asio::error_code ignored;
+                    socket_.close(ignored);
+                    handle_connect_error(ec);
+                    return;
+                }
+
+                bool resumed = SSL_session_reused(tls_stream_->native_handle()) == 1;
+                tls_->record_handshake(true, resumed, cost);
+                // TLS1.3的会话只能复用一次，复用握手之后也要收下服务端发来的新票据，否则下一次连接又退回完整握手
+                if (!session_slot_.ticket_received && SSL_version(tls_stream_->native_handle()) >= TLS1_3_VERSION) {
+                    wait_for_session_ticket(endpoint, generation);
+                    return;
+                }
+                on_connected(endpoint);
+            });
+    }
+
+    // TLS1.3的会话票据由服务端在握手完成后才发送，客户端不读就收不到。
+    // 握手后挂一个读操作把票据收下来，这样预热的空闲连接也能为后续连接提供可复用的会话。
+    // new_session回调里取消这个读操作，票据一到就结束等待；服务端不发票据时最多等kTicketTimeout。
+    // 每次握手后只做一次，期间若读到应用数据则缓存起来交给下一次async_read_some
+    void wait_for_session_ticket(const asio::ip::tcp::endpoint& endpoint, uint32_t generation) {
+        static constexpr auto kTicketTimeout = std::chrono::milliseconds(50);
+
+        prefetch_buffer_.resize(4096);
+        prefetch_size_ = 0;
+
+        // 回调发生在SSL_read内部，ssl::stream随后还会发起下一次底层读取，所以把取消投递出去，
+        // 等这次处理返回后再执行，取消的正是那次底层读取。
+        // 同一次读取可能连带读到应用数据而直接完成，这时调用方可能已经发起了新的读取，不能再取消
+        waiting_ticket_ = true;
+        session_slot_.on_ticket = [this]() {
+            asio::post(socket_.get_executor(), [this, self = shared_from_this()]() {
+                if (waiting_ticket_) {
+                    asio::error_code ignored;
+                    socket_.cancel(ignored);
+                }
+            });
+        };
+        ticket_timer_.expires_after(kTicketTimeout);
+        ticket_timer_.async_wait([this, self = shared_from_this(), generation](const asio::error_code& ec) {
+            if (!ec && waiting_ticket_ && generation == connect_generation_) {
+                asio::error_code ignored;
+                socket_.cancel(ignored);
+            }
+        });
+
+        tls_stream_->async_read_some(asio::buffer(prefetch_buffer_),
+            [this, self = shared_from_this(), endpoint, generation](const asio::error_code& ec, size_t n) {
+                waiting_ticket_ = false;
+                session_slot_.on_ticket = nullptr;
+                ticket_timer_.cancel();
+                if (generation != connect_generation_) {
+                    return;
+                }
+                if (ec && ec != asio::error::operation_aborted) {
+                    handle_connect_error(ec);
+                    return;
+                }
+                prefetch_size_ = ec ? 0 : n;
+                prefetch_buffer_.resize(prefetch_size_);
+                on_connected(endpoint);
+            });
+    }
+
+    // 连接(及握手)完成
+    void on_connected(const asio::ip::tcp::endpoint& endpoint) {
+        if (timeout_timer_) {
+            timeout_timer_->cancel();
+        }
+
+        status_ = ConnectionStatus::CONNECTED;
+        last_activity_ = std::chrono::steady_clock::now();
+        std::cout << "Connected to " << endpoint << std::endl;
+
+        if (connect_callback_) {
+            connect_callback_(true, shared_from_this());
+        }
+    }
+
     // 处理连接错误
     void handle_connect_error(const asio::error_code& ec) {
         std::cerr << "Connection error: " << ec.message() << std::endl;
@@ -220,6 +521,7 @@ private:
         if (reconnect_attempts_ < max_reconnect_attempts_) {
             // 尝试重连
             reconnect_attempts_++;
+            trace::instant(trace::Stage::RECONNECT, trace_id_);
             std::cout << "Attempting to reconnect (" << reconnect_attempts_ << "/" << max_reconnect_attempts_ << ")..." << std::endl;
             
             // 指数退避策略
@@ -228,7 +530,7 @@ private:
                 asio::steady_timer timer(socket_.get_executor(), delay);
                 timer.async_wait([this, self](const asio::error_code&) {
                     if (status_ == ConnectionStatus::DISCONNECTED && connect_callback_) {
-                        connect(connect_callback_);
+                        connect(connect_callback_, std::chrono::seconds(5), trace_id_);
                     }
                 });
             });
@@ -255,6 +557,13 @@ private:
 
     asio::ip::tcp::socket socket_;
     asio::ip::tcp::resolver resolver_;
+    TlsContext::Ptr tls_;
+    TlsContext::SessionSlot session_slot_; // 须在tls_stream_之前声明，保证SSL对象先析构
+    std::unique_ptr<asio::ssl::stream<asio::ip::tcp::socket&>> tls_stream_;
+    asio::steady_timer ticket_timer_;
+    std::vector<char> prefetch_buffer_; // 等待会话票据时读到的应用数据
+    size_t prefetch_size_ = 0;
+    bool waiting_ticket_ = false;
     std::unique_ptr<asio::steady_timer> timeout_timer_;
     
     std::string host_;
@@ -264,6 +573,8 @@ private:
     std::chrono::steady_clock::time_point last_activity_;
     int reconnect_attempts_;
     const int max_reconnect_attempts_;
+    uint32_t trace_id_ = 0;
+    uint32_t connect_generation_ = 0; // 每次连接尝试加1，超时时也加1，作废仍在途的解析/连接/握手回调
     
     ConnectCallback connect_callback_;
     ErrorCallback error_callback_;
@@ -280,7 +591,12 @@ public:
           config_(config),
           strand_(io_context),
           total_connections_(0),
-          is_running_(false) {
+          is_running_(false),
+          health_check_timer_(io_context) {
+        if (config_.ssl_context) {
+            tls_ = std::make_shared<TlsContext>(config_.ssl_context,
+                config_.tls_server_name.empty() ? config_.host : config_.tls_server_name);
+        }
     }
 
     ~ConnectionPool() {
@@ -297,8 +613,11 @@ public:
             is_running_ = true;
 
             // 创建最小数量的连接
-            for (size_t i = 0; i < config_.min_connections; ++i) {
+            // TLS下先只建一条，它完成完整握手拿到会话票据后再补齐，其余连接都走会话复用
+            if (tls_) {
                 create_connection();
+            } else {
+                top_up_connections();
             }
 
             // 启动健康检查定时器
@@ -336,8 +655,12 @@ public:
     }
 
     // 从连接池获取一个连接
-    void get_connection(ConnectionHandler handler) {
-        asio::post(strand_, [this, self = shared_from_this(), handler = std::move(handler)]() {
+    // trace_id: 调用方请求的追踪id，用于记录strand跳转、排队等待等阶段
+    void get_connection(ConnectionHandler handler, uint32_t trace_id = 0) {
+        trace::begin(trace::Stage::STRAND_HOP, trace_id);
+        asio::post(strand_, [this, self = shared_from_this(), handler = std::move(handler), trace_id]() {
+            trace::end(trace::Stage::STRAND_HOP, trace_id);
+
             // 检查是否有可用连接
             if (!available_connections_.empty()) {
                 auto connection = std::move(available_connections_.front());
@@ -346,19 +669,22 @@ public:
                 // 将连接标记为正在使用
                 in_use_connections_.push_back(connection);
                 
-                // 提交到io_context，确保在正确的线程中执行
-                asio::post(io_context_, std::bind(handler, connection));
+                trace::instant(trace::Stage::POOL_HIT, trace_id);
+                dispatch_to_handler(handler, connection, trace_id);
+                top_up_connections();
                 return;
             }
 
             // 如果没有达到最大连接数，创建新连接
             if (total_connections_ < config_.max_connections) {
-                create_connection_for_handler(std::move(handler));
+                create_connection_for_handler(std::move(handler), trace_id);
+                top_up_connections();
                 return;
             }
 
             // 否则，加入等待队列
-            waiting_handlers_.push_back(std::move(handler));
+            trace::begin(trace::Stage::POOL_WAIT, trace_id);
+            waiting_handlers_.push_back(WaitingHandler{std::move(handler), trace_id});
         });
     }
 
@@ -385,14 +711,14 @@ public:
 
             // 检查是否有等待的处理程序
             if (!waiting_handlers_.empty()) {
-                auto handler = std::move(waiting_handlers_.front());
+                auto waiting = std::move(waiting_handlers_.front());
                 waiting_handlers_.pop_front();
+                trace::end(trace::Stage::POOL_WAIT, waiting.trace_id);
                 
                 // 重新将连接标记为正在使用
                 in_use_connections_.push_back(connection);
                 
-                // 提交到io_context
-                asio::post(io_context_, std::bind(handler, connection));
+                dispatch_to_handler(waiting.handler, connection, waiting.trace_id);
             } else {
                 // 否则，将连接放回可用连接池
                 available_connections_.push_back(connection);
@@ -413,32 +739,69 @@ public:
         return status_;
     }
 
+    // 获取TLS握手统计，明文连接池返回全0
+    TlsStats get_tls_stats() const {
+        return tls_ ? tls_->stats() : TlsStats{};
+    }
+
 private:
     // 创建一个新连接
     void create_connection() {
         create_connection_for_handler(nullptr);
     }
 
+    // 补齐连接数:不少于最小连接数，并在使用中的连接之外保留prewarm_spare条空闲或握手中的连接
+    // 握手在这里提前完成，请求到来时直接拿到已握手的连接
+    void top_up_connections() {
+        if (!is_running_) {
+            return;
+        }
+        size_t target = std::max(config_.min_connections, in_use_connections_.size() + config_.prewarm_spare);
+        target = std::min(target, config_.max_connections);
+        while (total_connections_ < target) {
+            create_connection();
+        }
+    }
+
+    // 等待队列中的处理程序，附带请求的追踪id
+    struct WaitingHandler {
+        ConnectionHandler handler;
+        uint32_t trace_id;
+    };
+
+    // 提交到io_context，确保在正确的线程中执行
+    void dispatch_to_handler(const ConnectionHandler& handler, Connection::Ptr connection, uint32_t trace_id) {
+        trace::begin(trace::Stage::HANDOFF, trace_id);
+        asio::post(io_context_, [handler, connection = std::move(connection), trace_id]() {
+            trace::end(trace::Stage::HANDOFF, trace_id);
+            handler(connection);
+        });
+    }
+
     // 创建一个新连接并分配给处理程序（如果有）
-    void create_connection_for_handler(ConnectionHandler handler) {
+    void create_connection_for_handler(ConnectionHandler handler, uint32_t trace_id = 0) {
         total_connections_++;
         
-        auto connection = std::make_shared<Connection>(io_context_, config_.host, config_.port);
+        auto connection = std::make_shared<Connection>(io_context_, config_.host, config_.port, tls_);
+        // 没有请求在等的预建连接使用自己的追踪id
+        uint32_t connect_trace_id = trace_id ? trace_id : trace::new_id();
+        trace::begin(trace::Stage::CONNECT, connect_trace_id);
         
         // 设置错误处理回调
         connection->set_error_callback([this, self = shared_from_this()](const asio::error_code& ec, Connection::Ptr conn) {
             handle_connection_error(ec, conn);
         });
 
-        connection->connect([this, connection, handler](bool success, Connection::Ptr conn) {
-            asio::post(strand_, [this, success, connection, handler]() {
+        connection->connect([this, connection, handler, trace_id, connect_trace_id](bool success, Connection::Ptr conn) {
+            trace::end(trace::Stage::CONNECT, connect_trace_id);
+            asio::post(strand_, [this, success, connection, handler, trace_id]() {
                 if (!success) {
                     // 连接失败
                     total_connections_--;
                     
                     // 如果有处理程序等待，尝试创建另一个连接
                     if (handler) {
-                        create_connection_for_handler(std::move(handler));
+                        create_connection_for_handler(std::move(handler), trace_id);
                     }
                     return;
                 }
@@ -449,13 +812,15 @@ private:
                 if (handler) {
                     // 有处理程序等待，直接分配连接
                     in_use_connections_.push_back(connection);
-                    asio::post(io_context_, std::bind(handler, connection));
+                    dispatch_to_handler(handler, connection, trace_id);
                 } else {
                     // 没有处理程序等待，加入可用连接池
                     available_connections_.push_back(connection);
+                    // TLS启动时的第一条连接已拿到会话，其余预热连接此时再建
+                    top_up_connections();
                 }
             });
-        }, config_.connection_timeout);
+        }, config_.connection_timeout, connect_trace_id);
     }
 
     // 处理连接错误
@@ -511,7 +876,7 @@ private:
         // 复制可用连接列表用于检查
         {   
             // 注意：这里不需要额外的锁，因为我们在strand中执行
-            connections_to_check = available_connections_;
+            connections_to_check.assign(available_connections_.begin(), available_connections_.end());
         }
 
         // 检查每个连接
@@ -558,18 +923,19 @@ private:
 
     asio::io_context& io_context_;
     ConnectionPoolConfig config_;
+    TlsContext::Ptr tls_; // 所有连接共享，为空表示明文TCP
     asio::io_context::strand strand_; // 保护共享数据
 
     size_t total_connections_;
     std::deque<Connection::Ptr> available_connections_;
     std::vector<Connection::Ptr> in_use_connections_;
-    std::queue<ConnectionHandler> waiting_handlers_;
+    std::deque<WaitingHandler> waiting_handlers_;
 
     bool is_running_;
     asio::steady_timer health_check_timer_;
 
     mutable std::mutex status_mutex_;
-    Status status_;
+    Status status_{}; // 第一次update_status之前get_status也要返回0
 };
 
 // 使用连接池的示例
@@ -593,20 +959,27 @@ public:
     // 发送请求
     void send_request(const std::string& request_data, 
                       std::function<void(bool, const std::string&)> callback) {
+        uint32_t trace_id = trace::new_id();
+        trace::begin(trace::Stage::REQUEST, trace_id);
+
         // 从连接池获取连接
-        connection_pool_->get_connection([this, request_data, callback](Connection::Ptr connection) {
+        connection_pool_->get_connection([this, request_data, callback, trace_id](Connection::Ptr connection) {
             if (!connection || !connection->is_open()) {
+                trace::end(trace::Stage::REQUEST, trace_id);
                 callback(false, "Failed to get connection");
                 return;
             }
             
             // 发送请求数据
+            trace::begin(trace::Stage::WRITE, trace_id);
             connection->async_write(asio::buffer(request_data),
-                [this, connection, callback](const asio::error_code& ec, size_t) {
+                [this, connection, callback, trace_id](const asio::error_code& ec, size_t) {
+                    trace::end(trace::Stage::WRITE, trace_id);
                     if (ec) {
                         // 处理写入错误
                         std::cerr << "Write error: " << ec.message() << std::endl;
                         connection_pool_->return_connection(connection);
+                        trace::end(trace::Stage::REQUEST, trace_id);
                         callback(false, "Write failed: " + ec.message());
                         return;
                     }
@@ -615,10 +988,13 @@ public:
                     std::make_shared<std::vector<char>>(1024)->resize(1024);
                     auto buffer = std::make_shared<std::vector<char>>(1024);
                     
+                    trace::begin(trace::Stage::READ, trace_id);
                     connection->async_read_some(asio::buffer(*buffer),
-                        [this, connection, buffer, callback](const asio::error_code& ec, size_t bytes_read) {
+                        [this, connection, buffer, callback, trace_id](const asio::error_code& ec, size_t bytes_read) {
+                            trace::end(trace::Stage::READ, trace_id);
                             // 归还连接到连接池
                             connection_pool_->return_connection(connection);
+                            trace::end(trace::Stage::REQUEST, trace_id);
                             
                             if (ec) {
                                 std::cerr << "Read error: " << ec.message() << std::endl;
@@ -631,7 +1007,7 @@ public:
                             callback(true, response);
                         });
                 });
-        });
+        }, trace_id);
     }
     
     // 关闭客户端
@@ -0,0 +1,245 @@
+// timer.cpp中TLS连接池的握手测量
+// g++ -std=c++20 -O2 -pthread tls_handshake_bench.cpp -o tls_handshake_bench -lssl -lcrypto
+// ./tls_handshake_bench [rounds=50] [pool_size=4]
+// 进程内启动一个asio的TLS回显服务端(独立的io线程，每个连接一个会话，可以同时服务多个连接)，
+// 证书是启动时生成的自签名证书，不需要外部文件。
+// 1. 完整握手 vs 会话复用: 依次建立rounds条连接，每条用空缓存(完整握手)或共享缓存(复用)，统计握手次数和耗时
+// 2. 连接池: min_connections=pool_size时应为1次完整握手 + pool_size-1次复用，随后每条连接回显一次
+// 3. 连接超时: 服务端只接受TCP不做握手，超时回调必须恰好调用一次
+#include "timer.cpp"
+
+#include <openssl/evp.h>
+#include <openssl/x509v3.h>
+
+#include <cstdlib>
+#include <thread>
+
+using clock_type = std::chrono::steady_clock;
+
+// 生成localhost的自签名证书(P-256)
+static std::pair<EVP_PKEY*, X509*> make_self_signed() {
+    EVP_PKEY* key = EVP_EC_gen("P-256");
+    X509* cert = X509_new();
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    X509V3_CTX v3;
+    X509V3_set_ctx_nodb(&v3);
+    X509V3_set_ctx(&v3, cert, cert, nullptr, nullptr, 0);
+    X509_EXTENSION* san = X509V3_EXT_conf_nid(nullptr, &v3, NID_subject_alt_name, "DNS:localhost");
+    X509_add_ext(cert, san, -1);
+    X509_EXTENSION_free(san);
+    X509_sign(cert, key, EVP_sha256());
+    return {key, cert};
+}
+
+// 回显服务端的一个连接
+class EchoSession : public std::enable_shared_from_this<EchoSession> {
+public:
+    EchoSession(asio::ip::tcp::socket socket, asio::ssl::context& context)
+        : stream_(std::move(socket), context) {}
+
+    void start() {
+        stream_.async_handshake(asio::ssl::stream_base::server, [self = shared_from_this()](const asio::error_code& ec) {
+            if (!ec) {
+                self->read();
+            }
+        });
+    }
+
+private:
+    void read() {
+        stream_.async_read_some(asio::buffer(buffer_), [self = shared_from_this()](const asio::error_code& ec, size_t n) {
+            if (ec) {
+                return;
+            }
+            asio::async_write(self->stream_, asio::buffer(self->buffer_, n),
+                [self](const asio::error_code& ec, size_t) {
+                    if (!ec) {
+                        self->read();
+                    }
+                });
+        });
+    }
+
+    asio::ssl::stream<asio::ip::tcp::socket> stream_;
+    char buffer_[4096];
+};
+
+class EchoServer {
+public:
+    EchoServer(EVP_PKEY* key, X509* cert, bool handshake)
+        : context_(asio::ssl::context::tls_server), acceptor_(io_, {asio::ip::make_address("127.0.0.1"), 0}),
+          handshake_(handshake) {
+        SSL_CTX_use_certificate(context_.native_handle(), cert);
+        SSL_CTX_use_PrivateKey(context_.native_handle(), key);
+        SSL_CTX_set_min_proto_version(context_.native_handle(), TLS1_3_VERSION);
+        accept();
+        thread_ = std::thread([this] { io_.run(); });
+    }
+
+    ~EchoServer() {
+        io_.stop();
+        thread_.join();
+    }
+
+    std::string port() const { return std::to_string(acceptor_.local_endpoint().port()); }
+
+private:
+    void accept() {
+        acceptor_.async_accept([this](const asio::error_code& ec, asio::ip::tcp::socket socket) {
+            if (ec) {
+                return;
+            }
+            if (handshake_) {
+                std::make_shared<EchoSession>(std::move(socket), context_)->start();
+            } else {
+                stalled_.push_back(std::move(socket)); // 只占着TCP连接，不做握手
+            }
+            accept();
+        });
+    }
+
+    asio::io_context io_;
+    asio::ssl::context context_;
+    asio::ip::tcp::acceptor acceptor_;
+    bool handshake_;
+    std::vector<asio::ip::tcp::socket> stalled_;
+    std::thread thread_;
+};
+
+static std::shared_ptr<asio::ssl::context> make_client_context(X509* cert) {
+    auto context = std::make_shared<asio::ssl::context>(asio::ssl::context::tls_client);
+    X509_STORE_add_cert(SSL_CTX_get_cert_store(context->native_handle()), cert);
+    context->set_verify_mode(asio::ssl::verify_peer);
+    return context;
+}
+
+// 建立一条连接并等到连接回调，返回从connect到回调的耗时(含握手及等待会话票据)
+static std::chrono::nanoseconds connect_once(asio::io_context& io, const std::string& port, TlsContext::Ptr tls) {
+    auto connection = std::make_shared<Connection>(io, "localhost", port, std::move(tls));
+    bool done = false;
+    bool ok = false;
+    auto start = clock_type::now();
+    connection->connect([&](bool success, Connection::Ptr) {
+        done = true;
+        ok = success;
+    });
+    io.restart();
+    while (!done) {
+        io.run_one();
+    }
+    auto cost = clock_type::now() - start;
+    if (!ok) {
+        std::cerr << "connect failed" << std::endl;
+        std::exit(1);
+    }
+    connection->close();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(cost);
+}
+
+static void print_stats(const char* name, const TlsStats& s, std::chrono::nanoseconds connect_time, int rounds) {
+    uint64_t handshakes = s.full_handshakes + s.resumed_handshakes;
+    std::cout << name << ": full " << s.full_handshakes << ", resumed " << s.resumed_handshakes
+              << ", failed " << s.failed_handshakes << ", handshake "
+              << (handshakes ? s.handshake_time.count() / handshakes / 1000 : 0) << " us, connect "
+              << connect_time.count() / rounds / 1000 << " us" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 50;
+    size_t pool_size = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 4;
+    auto [key, cert] = make_self_signed();
+    EchoServer server(key, cert, true);
+    asio::io_context io;
+    auto client_context = make_client_context(cert);
+
+    // 1. 每条连接一个新的TlsContext，缓存为空，全部是完整握手
+    TlsStats full;
+    std::chrono::nanoseconds full_connect{0};
+    for (int i = 0; i < rounds; ++i) {
+        auto tls = std::make_shared<TlsContext>(client_context, "localhost");
+        full_connect += connect_once(io, server.port(), tls);
+        TlsStats s = tls->stats();
+        full.full_handshakes += s.full_handshakes;
+        full.resumed_handshakes += s.resumed_handshakes;
+        full.failed_handshakes += s.failed_handshakes;
+        full.handshake_time += s.handshake_time;
+    }
+
+    // 共享一个TlsContext，第一条完整握手拿到票据，之后都复用
+    auto shared = std::make_shared<TlsContext>(client_context, "localhost");
+    std::chrono::nanoseconds resumed_connect{0};
+    for (int i = 0; i < rounds; ++i) {
+        resumed_connect += connect_once(io, server.port(), shared);
+    }
+    print_stats("fresh cache ", full, full_connect, rounds);
+    print_stats("shared cache", shared->stats(), resumed_connect, rounds);
+
+    // 2. 连接池启动后的握手构成
+    ConnectionPoolConfig config;
+    config.host = "localhost";
+    config.port = server.port();
+    config.min_connections = pool_size;
+    config.max_connections = pool_size;
+    config.ssl_context = client_context;
+    auto pool = std::make_shared<ConnectionPool>(io, config);
+    pool->start();
+    io.restart();
+    auto deadline = clock_type::now() + std::chrono::seconds(5);
+    while (pool->get_status().available_connections < pool_size && clock_type::now() < deadline) {
+        io.run_for(std::chrono::milliseconds(10));
+    }
+    size_t echoed = 0;
+    for (size_t i = 0; i < pool_size; ++i) {
+        pool->get_connection([&, pool](Connection::Ptr connection) {
+            if (!connection) {
+                return;
+            }
+            auto buffer = std::make_shared<std::array<char, 5>>();
+            connection->async_write(asio::buffer("ping", 4), [&, pool, connection, buffer](const asio::error_code& ec, size_t) {
+                if (ec) {
+                    return;
+                }
+                connection->async_read_some(asio::buffer(*buffer), [&, pool, connection, buffer](const asio::error_code& ec, size_t n) {
+                    echoed += !ec && n == 4;
+                    pool->return_connection(connection);
+                });
+            });
+        });
+    }
+    deadline = clock_type::now() + std::chrono::seconds(5);
+    while (echoed < pool_size && clock_type::now() < deadline) {
+        io.run_for(std::chrono::milliseconds(10));
+    }
+    TlsStats s = pool->get_tls_stats();
+    std::cout << "pool of " << pool_size << ": full " << s.full_handshakes << ", resumed " << s.resumed_handshakes
+              << ", echoed " << echoed << std::endl;
+    bool pool_ok = s.full_handshakes == 1 && s.resumed_handshakes == pool_size - 1 && echoed == pool_size;
+    pool->stop();
+    io.restart();
+    io.poll();
+
+    // 3. 握手卡住时，超时回调只调用一次
+    EchoServer stalled(key, cert, false);
+    auto connection = std::make_shared<Connection>(io, "localhost", stalled.port(),
+                                                   std::make_shared<TlsContext>(client_context, "localhost"));
+    int callbacks = 0;
+    connection->connect([&](bool success, Connection::Ptr) { callbacks += success ? 100 : 1; }, std::chrono::seconds(1));
+    io.restart();
+    io.run_for(std::chrono::seconds(2));
+    std::cout << "stalled handshake: " << callbacks << " callback(s)" << std::endl;
+
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    if (!pool_ok || callbacks != 1) {
+        std::cerr << "unexpected result" << std::endl;
+        return 1;
+    }
+    return 0;
+}
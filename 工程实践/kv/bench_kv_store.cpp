@@ -0,0 +1,143 @@
+// kv存储的基准测试
+// g++ -std=c++20 -O2 -pthread bench_kv_store.cpp -o bench_kv_store
+// ./bench_kv_store [keys=10000000] [dir=./kv_bench_data] [writers=8]
+// 1. 写入吞吐: 每次写入都要落盘时，单线程 vs 多线程组提交；以及批量导入(WriteBatch，不逐条落盘)
+// 2. 读取延迟: 随机读取已有的键，分别取字符串和用反射解码结构体，统计分位数
+// 3. 启动时间: 重新打开数据库，单线程恢复 vs 并行恢复
+#include "kv_store.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using clock_type = std::chrono::steady_clock;
+
+struct Profile {
+    ENABLE_REFLECT(Profile)
+    REFLECTABLE(Profile, uint64_t, id)
+    REFLECTABLE(Profile, uint32_t, level)
+    REFLECTABLE(Profile, int64_t, balance)
+    REFLECTABLE(Profile, std::string, name)
+};
+
+static double secondsSince(clock_type::time_point start) {
+    return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+static kv::Key profileKey(uint64_t id) { return kv::keyFromTypeAndId(1, id); }
+
+static Profile makeProfile(uint64_t id) {
+    return Profile{id, static_cast<uint32_t>(id % 100), static_cast<int64_t>(id * 3), "user" + std::to_string(id)};
+}
+
+static void check(kv::Error error, const char *what) {
+    if (error != kv::Error::Ok) {
+        std::fprintf(stderr, "%s failed: %d\n", what, static_cast<int>(error));
+        std::exit(1);
+    }
+}
+
+// 每次写入都等待落盘，返回每秒写入数
+static double syncedWrites(kv::Database &db, unsigned writers, size_t perWriter) {
+    auto start = clock_type::now();
+    {
+        std::vector<std::jthread> threads;
+        for (unsigned t = 0; t < writers; ++t) {
+            threads.emplace_back([&db, t, perWriter] {
+                for (size_t i = 0; i < perWriter; ++i) {
+                    check(db.put(kv::keyFromTypeAndId(2 + t, i), makeProfile(i)), "put");
+                }
+            });
+        }
+    }
+    return writers * perWriter / secondsSince(start);
+}
+
+template <typename F>
+static void printLatency(const char *name, size_t samples, F &&op) {
+    std::vector<uint32_t> ns(samples);
+    for (size_t i = 0; i < samples; ++i) {
+        auto start = clock_type::now();
+        op(i);
+        ns[i] = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - start).count());
+    }
+    std::sort(ns.begin(), ns.end());
+    auto at = [&](double q) { return ns[std::min(samples - 1, static_cast<size_t>(q * samples))]; };
+    std::printf("  %-24s p50 %5u ns  p99 %6u ns  p99.9 %7u ns\n", name, at(0.5), at(0.99), at(0.999));
+}
+
+int main(int argc, char **argv) {
+    size_t keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10'000'000;
+    std::filesystem::path dir = argc > 2 ? argv[2] : "kv_bench_data";
+    unsigned writers = argc > 3 ? std::atoi(argv[3]) : 8;
+    std::filesystem::remove_all(dir);
+
+    kv::Settings settings;
+    settings.backgroundMaintenance = false;
+    kv::Database db;
+    check(db.open(dir, settings), "open");
+
+    std::printf("synced writes (SyncMode::Batch)\n");
+    double single = syncedWrites(db, 1, 2000);
+    std::printf("  %-24s %9.0f writes/s\n", "1 writer", single);
+    double grouped = syncedWrites(db, writers, 2000);
+    kv::Stats s = db.stats();
+    std::printf("  %-24s %9.0f writes/s  (%.1f writes per fdatasync)\n", (std::to_string(writers) + " writers").c_str(),
+                grouped, static_cast<double>(s.writes) / s.batches);
+
+    // 批量导入: 每个WriteBatch 1000条，组提交只在批次之间落盘
+    auto start = clock_type::now();
+    kv::WriteBatch batch;
+    for (size_t i = 0; i < keys; ++i) {
+        batch.put(profileKey(i), makeProfile(i));
+        if (batch.count() == 1000 || i + 1 == keys) {
+            check(db.write(batch), "write");
+            batch.clear();
+        }
+    }
+    double loadSeconds = secondsSince(start);
+    s = db.stats();
+    std::printf("bulk load %zu keys: %.2f s, %.2f M keys/s, %.1f MB/s, %zu segments\n", keys, loadSeconds,
+                keys / loadSeconds / 1e6, s.diskSize / loadSeconds / 1e6, s.segments);
+
+    std::printf("random reads\n");
+    constexpr size_t kSamples = 1'000'000;
+    std::mt19937_64 rng(42);
+    std::vector<uint64_t> ids(kSamples);
+    for (auto &id : ids) {
+        id = rng() % keys;
+    }
+    std::string value;
+    size_t misses = 0;
+    printLatency("get(string)", kSamples, [&](size_t i) { misses += !db.get(profileKey(ids[i]), value); });
+    Profile profile;
+    printLatency("get<Profile>", kSamples, [&](size_t i) {
+        misses += !db.get(profileKey(ids[i]), profile) || profile.id != ids[i];
+    });
+    printLatency("get(missing key)", kSamples, [&](size_t i) { misses += db.contains(profileKey(keys + ids[i])); });
+    if (misses) {
+        std::fprintf(stderr, "%zu unexpected results\n", misses);
+        return 1;
+    }
+
+    std::printf("recovery of %zu keys\n", db.stats().keys);
+    db.close();
+    std::vector<unsigned> threadCounts{1};
+    if (std::thread::hardware_concurrency() > 1) {
+        threadCounts.push_back(std::thread::hardware_concurrency());
+    }
+    for (unsigned threads : threadCounts) {
+        settings.recoveryThreads = threads;
+        check(db.open(dir, settings), "open");
+        const kv::RecoveryStats &r = db.recoveryStats();
+        std::printf("  %2u threads: %.2f s (%zu records in %zu segments)\n", threads, r.seconds, r.records, r.segments);
+        db.close();
+    }
+    std::filesystem::remove_all(dir);
+    return 0;
+}
@@ -0,0 +1,362 @@
+#ifndef KV_BINLOG_HPP_
+#define KV_BINLOG_HPP_
+// binlog的磁盘格式与段文件
+// 和 支持持久化的嵌入式kv存储系统.md 里的设计相比，这里把值直接放在binlog记录后面，不再单独写数据文件，
+// binlog按固定大小切分成段文件 <root>/000001.binlog、000002.binlog ...，压缩时以段为单位回收空间
+//
+// 段文件: [SegmentHeader 32字节][记录][记录]...[全0，尚未写入]
+// 记录:   [RecordHeader 32字节][值][填充到8字节对齐]
+// 段文件创建时预分配到固定大小并整段只读mmap；追加用pwritev，读取直接访问映射(两者共享page cache)
+// 所有整数按小端存放，只支持小端机器
+// 只实现了POSIX版本(mmap/pwritev/fdatasync)
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace kv {
+
+static_assert(std::endian::native == std::endian::little, "binlog format is little-endian");
+
+enum class Error : uint8_t {
+    Ok,
+    IO,        // 读写文件失败，之后的写入都会返回IO
+    Locked,    // 目录已被其他进程打开
+    Corrupted, // 段文件头损坏
+    TooLarge,  // 值太大，放不进一个段
+};
+
+// 128位键
+struct Key {
+    uint64_t high = 0;
+    uint64_t low = 0;
+
+    friend bool operator==(const Key &a, const Key &b) = default;
+};
+
+enum class RecordType : uint8_t {
+    Put = 1,
+    Remove = 2,
+};
+
+struct RecordHeader {
+    uint32_t checksum;  // XXH32(头部checksum之后的28字节 + 值)
+    RecordType type;
+    uint8_t reserved0;
+    uint16_t reserved1;
+    uint32_t size;      // 值的字节数
+    uint32_t time;      // 写入时间(unix秒)，清理器据此判断过期
+    Key key;
+};
+static_assert(sizeof(RecordHeader) == 32);
+
+struct SegmentHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t id;
+    uint32_t capacity;
+    uint32_t reserved[3];
+};
+static_assert(sizeof(SegmentHeader) == 32);
+
+inline constexpr char kSegmentMagic[8] = {'K', 'V', 'B', 'I', 'N', 'L', 'O', 'G'};
+inline constexpr uint32_t kSegmentVersion = 1;
+
+// 记录占用的字节数，保证下一条记录的头部8字节对齐
+inline constexpr uint32_t recordLength(uint32_t size) {
+    return (static_cast<uint32_t>(sizeof(RecordHeader)) + size + 7) & ~7u;
+}
+
+// ---- XXH32 ----
+// 设计文档推荐的校验和: 比CRC32冲突少，不需要SSE4.2也很快
+
+namespace details {
+
+inline constexpr uint32_t kPrime1 = 2654435761u;
+inline constexpr uint32_t kPrime2 = 2246822519u;
+inline constexpr uint32_t kPrime3 = 3266489917u;
+inline constexpr uint32_t kPrime4 = 668265263u;
+inline constexpr uint32_t kPrime5 = 374761393u;
+
+inline uint32_t rotl32(uint32_t x, int r) {
+    return (x << r) | (x >> (32 - r));
+}
+
+inline uint32_t read32(const unsigned char *p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t xxhRound(uint32_t acc, uint32_t lane) {
+    return rotl32(acc + lane * kPrime2, 13) * kPrime1;
+}
+
+} // namespace details
+
+inline uint32_t xxhash32(const void *data, size_t n, uint32_t seed = 0) {
+    using namespace details;
+    const auto *p = static_cast<const unsigned char *>(data);
+    const unsigned char *end = p + n;
+    uint32_t h;
+    if (n >= 16) {
+        uint32_t v1 = seed + kPrime1 + kPrime2;
+        uint32_t v2 = seed + kPrime2;
+        uint32_t v3 = seed;
+        uint32_t v4 = seed - kPrime1;
+        for (; p + 16 <= end; p += 16) {
+            v1 = xxhRound(v1, read32(p));
+            v2 = xxhRound(v2, read32(p + 4));
+            v3 = xxhRound(v3, read32(p + 8));
+            v4 = xxhRound(v4, read32(p + 12));
+        }
+        h = rotl32(v1, 1) + rotl32(v2, 7) + rotl32(v3, 12) + rotl32(v4, 18);
+    } else {
+        h = seed + kPrime5;
+    }
+    h += static_cast<uint32_t>(n);
+    for (; p + 4 <= end; p += 4) {
+        h = rotl32(h + read32(p) * kPrime3, 17) * kPrime4;
+    }
+    for (; p < end; ++p) {
+        h = rotl32(h + *p * kPrime5, 11) * kPrime1;
+    }
+    h ^= h >> 15;
+    h *= kPrime2;
+    h ^= h >> 13;
+    h *= kPrime3;
+    h ^= h >> 16;
+    return h;
+}
+
+// 记录的校验和覆盖头部checksum之后的部分和值，record指向记录开头
+inline uint32_t recordChecksum(const char *record, uint32_t size) {
+    constexpr size_t skip = sizeof(uint32_t);
+    return xxhash32(record + skip, sizeof(RecordHeader) - skip + size);
+}
+
+inline std::filesystem::path segmentPath(const std::filesystem::path &root, uint32_t id) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%06u.binlog", id);
+    return root / name;
+}
+
+// 一个段文件: 整段只读映射，由持有binlog写权限的线程在end()处追加
+class Segment {
+public:
+    Segment(const Segment &) = delete;
+    Segment &operator=(const Segment &) = delete;
+
+    ~Segment() {
+        if (_map) {
+            munmap(_map, _capacity);
+        }
+        if (_fd >= 0) {
+            ::close(_fd);
+        }
+        if (_unlinkOnClose) {
+            std::error_code ec;
+            std::filesystem::remove(_path, ec);
+        }
+    }
+
+    // 新建并预分配capacity字节
+    static std::unique_ptr<Segment> create(const std::filesystem::path &root, uint32_t id, uint32_t capacity, Error &error) {
+        std::unique_ptr<Segment> segment(new Segment(segmentPath(root, id), id));
+        segment->_fd = ::open(segment->_path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (segment->_fd < 0) {
+            error = Error::IO;
+            return nullptr;
+        }
+        // 文件已经建出来了，后面任何一步失败都要删掉，否则下次打开时会被当成损坏的段
+        segment->_unlinkOnClose = true;
+        if (posix_fallocate(segment->_fd, 0, capacity) != 0) {
+            error = Error::IO;
+            return nullptr;
+        }
+        SegmentHeader header{};
+        std::memcpy(header.magic, kSegmentMagic, sizeof(header.magic));
+        header.version = kSegmentVersion;
+        header.id = id;
+        header.capacity = capacity;
+        // 头部立即落盘: 换段后到第一次提交之间断电，留下的也是一个合法的空段
+        if (::pwrite(segment->_fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))
+            || ::fdatasync(segment->_fd) != 0 || !segment->map(capacity)) {
+            error = Error::IO;
+            return nullptr;
+        }
+        segment->_unlinkOnClose = false;
+        segment->_end = sizeof(SegmentHeader);
+        return segment;
+    }
+
+    // 打开已有的段文件，end()需要由scan的结果设置
+    static std::unique_ptr<Segment> open(const std::filesystem::path &path, uint32_t id, Error &error) {
+        std::unique_ptr<Segment> segment(new Segment(path, id));
+        segment->_fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+        struct stat st{};
+        if (segment->_fd < 0 || fstat(segment->_fd, &st) != 0) {
+            error = Error::IO;
+            return nullptr;
+        }
+        if (st.st_size < static_cast<off_t>(sizeof(SegmentHeader)) || st.st_size > UINT32_MAX) {
+            error = Error::Corrupted;
+            return nullptr;
+        }
+        if (!segment->map(static_cast<uint32_t>(st.st_size))) {
+            error = Error::IO;
+            return nullptr;
+        }
+        SegmentHeader header;
+        std::memcpy(&header, segment->_map, sizeof(header));
+        if (std::memcmp(header.magic, kSegmentMagic, sizeof(header.magic)) != 0 || header.version != kSegmentVersion
+            || header.id != id) {
+            error = Error::Corrupted;
+            return nullptr;
+        }
+        segment->_end = sizeof(SegmentHeader);
+        return segment;
+    }
+
+    uint32_t id() const { return _id; }
+    uint32_t capacity() const { return _capacity; }
+    uint32_t end() const { return _end; }
+    uint32_t remaining() const { return _capacity - _end; }
+    const char *data() const { return _map; }
+
+    const RecordHeader &header(uint32_t offset) const {
+        return *reinterpret_cast<const RecordHeader *>(_map + offset);
+    }
+
+    const char *value(uint32_t offset) const { return _map + offset + sizeof(RecordHeader); }
+
+    bool verify(uint32_t offset) const {
+        const RecordHeader &h = header(offset);
+        return recordChecksum(_map + offset, h.size) == h.checksum;
+    }
+
+    // 把iov依次写到end()处，调用方保证放得下
+    bool append(const iovec *iov, int count, size_t bytes) {
+        size_t done = 0;
+        while (done < bytes) {
+            // 短写时跳过已经写完的部分重试
+            iovec rest[IOV_MAX];
+            int n = 0;
+            size_t skip = done;
+            for (int i = 0; i < count; ++i) {
+                if (skip >= iov[i].iov_len) {
+                    skip -= iov[i].iov_len;
+                    continue;
+                }
+                rest[n].iov_base = static_cast<char *>(iov[i].iov_base) + skip;
+                rest[n].iov_len = iov[i].iov_len - skip;
+                skip = 0;
+                ++n;
+            }
+            ssize_t written = ::pwritev(_fd, rest, n, static_cast<off_t>(_end + done));
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            done += static_cast<size_t>(written);
+        }
+        _end += static_cast<uint32_t>(bytes);
+        return true;
+    }
+
+    bool sync() { return ::fdatasync(_fd) == 0; }
+
+    // 压缩完成后删除文件；最后一个引用(映射)释放时才真正unlink
+    void unlinkOnClose() { _unlinkOnClose = true; }
+
+    // 从第一条记录开始校验，遇到全0、长度越界或校验和不符就停下，返回有效数据的末尾
+    // visit(const RecordHeader &, uint32_t offset)
+    template <typename Visitor>
+    uint32_t scan(Visitor &&visit) const {
+        uint32_t offset = sizeof(SegmentHeader);
+        while (offset + sizeof(RecordHeader) <= _capacity) {
+            const RecordHeader &h = header(offset);
+            if (h.type != RecordType::Put && h.type != RecordType::Remove) {
+                break;
+            }
+            uint64_t length = recordLength(h.size);
+            if (h.size > _capacity || offset + length > _capacity || !verify(offset)) {
+                break;
+            }
+            visit(h, offset);
+            offset += static_cast<uint32_t>(length);
+        }
+        return offset;
+    }
+
+    void setEnd(uint32_t end) { _end = end; }
+
+    // 崩溃时一次批量写入可能只有一部分落盘(页不一定按顺序写回)，有效末尾之后还可能残留完整的记录。
+    // 继续追加前把末尾之后全部清零，否则新记录的边界恰好对上时，下次恢复会把残留的记录当成有效记录重放。
+    // 优先用FALLOC_FL_ZERO_RANGE/PUNCH_HOLE只改元数据，文件系统不支持时退回写0
+    bool zeroTail() {
+        off_t begin = _end;
+        off_t length = static_cast<off_t>(_capacity) - begin;
+        if (length <= 0) {
+            return true;
+        }
+#if defined(FALLOC_FL_ZERO_RANGE)
+        if (fallocate(_fd, FALLOC_FL_ZERO_RANGE, begin, length) == 0) {
+            return sync();
+        }
+#endif
+#if defined(FALLOC_FL_PUNCH_HOLE)
+        if (fallocate(_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, begin, length) == 0) {
+            return posix_fallocate(_fd, begin, length) == 0 && sync();
+        }
+#endif
+        static const char zeros[64 * 1024] = {};
+        for (off_t offset = begin; offset < begin + length;) {
+            size_t n = static_cast<size_t>(std::min<off_t>(sizeof(zeros), begin + length - offset));
+            if (::pwrite(_fd, zeros, n, offset) != static_cast<ssize_t>(n)) {
+                return false;
+            }
+            offset += static_cast<off_t>(n);
+        }
+        return sync();
+    }
+
+private:
+    Segment(std::filesystem::path path, uint32_t id) : _path(std::move(path)), _id(id) {}
+
+    bool map(uint32_t capacity) {
+        void *p = mmap(nullptr, capacity, PROT_READ, MAP_SHARED, _fd, 0);
+        if (p == MAP_FAILED) {
+            return false;
+        }
+        _map = static_cast<char *>(p);
+        _capacity = capacity;
+        return true;
+    }
+
+    std::filesystem::path _path;
+    uint32_t _id = 0;
+    int _fd = -1;
+    char *_map = nullptr;
+    uint32_t _capacity = 0;
+    uint32_t _end = 0;
+    bool _unlinkOnClose = false;
+};
+
+} // namespace kv
+
+#endif // KV_BINLOG_HPP_
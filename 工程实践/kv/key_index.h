@@ -0,0 +1,194 @@
+#ifndef KV_KEY_INDEX_HPP_
+#define KV_KEY_INDEX_HPP_
+// 全内存索引: 键 -> 值在binlog中的位置
+// 设计文档里用的是std::unordered_map<Key, Entry>，每个节点一次堆分配，查找要跳一次指针。
+// 这里换成开放寻址(线性探测)，条目直接放在连续数组里，一次查找通常只碰一个缓存行；
+// 删除用backward shift，不留墓碑，长时间增删之后探测长度也不会变长。
+// 索引按键的哈希分成64个分片，恢复时每个线程只负责一部分分片，可以并行重建
+#include "binlog.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace kv {
+
+// 每个条目32字节，两个条目一个缓存行
+struct Entry {
+    Key key;
+    uint32_t segment; // 0表示空槽，段编号从1开始
+    uint32_t offset;  // 记录在段内的偏移
+    uint32_t size;    // 值的字节数
+    uint32_t time;    // 最近写入/读取的时间(unix秒)，读取时用atomic_ref更新
+};
+static_assert(sizeof(Entry) == 32);
+
+inline uint64_t hashKey(const Key &key) {
+    // 键可能是有规律的(keyFromTypeAndId)，先混合一次
+    uint64_t h = key.high ^ (key.low * 0x9e3779b97f4a7c15ull);
+    h ^= h >> 32;
+    h *= 0xd6e8feb86659fd93ull;
+    h ^= h >> 32;
+    return h;
+}
+
+// 一个分片: 容量是2的幂，负载超过3/4时翻倍
+class IndexShard {
+public:
+    size_t size() const { return _size; }
+    size_t capacity() const { return _mask + 1; }
+
+    Entry *find(const Key &key, uint64_t hash) {
+        if (_size == 0) {
+            return nullptr;
+        }
+        for (size_t i = hash & _mask;; i = (i + 1) & _mask) {
+            Entry &e = _slots[i];
+            if (e.segment == 0) {
+                return nullptr;
+            }
+            if (e.key == key) {
+                return &e;
+            }
+        }
+    }
+
+    // 返回键所在的槽位，不存在时插入一个segment为0的新条目，由调用方填写
+    Entry *insert(const Key &key, uint64_t hash, bool &inserted) {
+        if ((_size + 1) * 4 > capacity() * 3) {
+            rehash(capacity() * 2);
+        }
+        for (size_t i = hash & _mask;; i = (i + 1) & _mask) {
+            Entry &e = _slots[i];
+            if (e.segment == 0) {
+                e.key = key;
+                ++_size;
+                inserted = true;
+                return &e;
+            }
+            if (e.key == key) {
+                inserted = false;
+                return &e;
+            }
+        }
+    }
+
+    // 删除并把被删除的条目拷到removed
+    bool erase(const Key &key, uint64_t hash, Entry &removed) {
+        Entry *e = find(key, hash);
+        if (!e) {
+            return false;
+        }
+        removed = *e;
+        // backward shift: 把后面探测链上的条目往前挪，直到遇到空槽或已经在理想位置的条目
+        size_t hole = static_cast<size_t>(e - _slots.get());
+        for (size_t i = (hole + 1) & _mask;; i = (i + 1) & _mask) {
+            Entry &next = _slots[i];
+            if (next.segment == 0) {
+                break;
+            }
+            size_t ideal = hashKey(next.key) & _mask;
+            // ideal不在(hole, i]之间(环形)时，next可以挪到hole
+            if (((i - ideal) & _mask) >= ((i - hole) & _mask)) {
+                _slots[hole] = next;
+                hole = i;
+            }
+        }
+        _slots[hole].segment = 0;
+        --_size;
+        return true;
+    }
+
+    void reserve(size_t n) {
+        size_t capacity = 16;
+        while (capacity * 3 < n * 4) {
+            capacity *= 2;
+        }
+        if (capacity > this->capacity()) {
+            rehash(capacity);
+        }
+    }
+
+    // 按槽位访问，给清理器增量扫描和随机采样用
+    Entry &slot(size_t i) { return _slots[i]; }
+
+    template <typename F>
+    void forEach(F &&f) {
+        for (size_t i = 0; i <= _mask && _size; ++i) {
+            if (_slots[i].segment != 0) {
+                f(_slots[i]);
+            }
+        }
+    }
+
+private:
+    void rehash(size_t capacity) {
+        std::unique_ptr<Entry[]> old = std::move(_slots);
+        size_t oldCapacity = this->capacity();
+        _slots = std::make_unique<Entry[]>(capacity); // 值初始化，segment全为0
+        _mask = capacity - 1;
+        for (size_t i = 0; old && i < oldCapacity; ++i) {
+            if (old[i].segment == 0) {
+                continue;
+            }
+            for (size_t j = hashKey(old[i].key) & _mask;; j = (j + 1) & _mask) {
+                if (_slots[j].segment == 0) {
+                    _slots[j] = old[i];
+                    break;
+                }
+            }
+        }
+    }
+
+    std::unique_ptr<Entry[]> _slots = std::make_unique<Entry[]>(16);
+    size_t _mask = 15;
+    size_t _size = 0;
+};
+
+class KeyIndex {
+public:
+    static constexpr size_t kShardBits = 6;
+    static constexpr size_t kShards = size_t(1) << kShardBits;
+
+    // 分片用哈希的高位，分片内的槽位用低位
+    static size_t shardOf(uint64_t hash) { return hash >> (64 - kShardBits); }
+
+    Entry *find(const Key &key) {
+        uint64_t h = hashKey(key);
+        return _shards[shardOf(h)].find(key, h);
+    }
+
+    Entry *insert(const Key &key, bool &inserted) {
+        uint64_t h = hashKey(key);
+        return _shards[shardOf(h)].insert(key, h, inserted);
+    }
+
+    bool erase(const Key &key, Entry &removed) {
+        uint64_t h = hashKey(key);
+        return _shards[shardOf(h)].erase(key, h, removed);
+    }
+
+    IndexShard &shard(size_t i) { return _shards[i]; }
+
+    size_t size() const {
+        size_t n = 0;
+        for (const IndexShard &s : _shards) {
+            n += s.size();
+        }
+        return n;
+    }
+
+    void clear() {
+        for (IndexShard &s : _shards) {
+            s = IndexShard();
+        }
+    }
+
+private:
+    IndexShard _shards[kShards];
+};
+
+} // namespace kv
+
+#endif // KV_KEY_INDEX_HPP_
@@ -0,0 +1,964 @@
+#ifndef KV_STORE_HPP_
+#define KV_STORE_HPP_
+// 支持持久化的嵌入式kv存储(设计见 ../支持持久化的嵌入式kv存储系统.md)
+//
+// 写入: 先写binlog再更新内存索引。多个线程同时写入时做组提交(group commit):
+//       排在队首的写入者当leader，把排队的写入一起用一次pwritev写出、一次fdatasync落盘，再唤醒其他写入者
+// 读取: 在内存索引里找到位置，直接从mmap的段文件里拷贝/解码，不需要read系统调用
+// 后台: 清理器(过期/超出容量的键)和压缩器(回收垃圾多的段)每次只处理有限的条目，
+//       两片之间让出binlog的写权限，前台写入最多等待一片的时间
+// 恢复: 各段并行校验并按分片分桶，再按分片并行重放到索引
+//
+// 值可以是任意字节，也可以是带反射信息的结构体(用 cpp/反射/binary_codec.h 编码)
+#include "binlog.h"
+#include "key_index.h"
+
+#include "../../cpp/反射/binary_codec.h"
+#include "../../cpp/反射/compare.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <shared_mutex>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <sys/file.h>
+
+namespace kv {
+
+// 由字符串生成键: 两个不同种子的64位哈希拼成128位
+inline Key keyFromString(std::string_view s) {
+    return Key{reflection::details::hashBytes(s.data(), s.size()),
+               reflection::details::hashBytes(s.data(), s.size(), 0x243f6a8885a308d3ull)};
+}
+
+// 复合键: 高64位放类型，低64位放id
+inline Key keyFromTypeAndId(uint32_t type, uint64_t id) {
+    return Key{type, id};
+}
+
+inline uint32_t currentTime() {
+    return static_cast<uint32_t>(std::time(nullptr));
+}
+
+enum class SyncMode {
+    Batch,    // 每次组提交后fdatasync，返回成功即已落盘
+    Periodic, // 后台线程每隔syncInterval落盘一次，崩溃最多丢失这段时间的写入
+    None,     // 只写到page cache，进程崩溃不丢，掉电可能丢
+};
+
+struct Settings {
+    uint32_t segmentSize = 64 * 1024 * 1024;
+    SyncMode sync = SyncMode::Batch;
+    std::chrono::milliseconds syncInterval{100};
+    size_t maxBatchBytes = 4 * 1024 * 1024; // 一次组提交最多合并的字节数
+
+    int64_t totalSizeLimit = 0; // 有效记录的总字节数上限，超过后按最近使用时间淘汰，0表示不限
+    uint32_t totalTimeLimit = 0; // 秒，超过这么久没有读写的键被清理，0表示不限
+
+    double compactGarbageRatio = 0.5;  // 已封口的段里垃圾占比达到多少开始压缩
+    size_t compactSliceRecords = 1024; // 压缩每片最多处理的记录数
+    size_t staleRemoveChunk = 256;     // 清理每片最多删除的键数
+
+    bool backgroundMaintenance = true;
+    std::chrono::milliseconds maintenanceInterval{100}; // 空闲时检查的间隔
+    std::chrono::milliseconds sliceInterval{1};         // 有活干时两片之间的间隔
+
+    unsigned recoveryThreads = 0; // 0表示hardware_concurrency
+    bool verifyOnRead = false;    // 读取时校验校验和
+};
+
+struct Stats {
+    size_t keys = 0;
+    int64_t totalSize = 0;   // 有效记录的字节数
+    int64_t diskSize = 0;    // 各段已写入的字节数
+    size_t segments = 0;
+    uint64_t batches = 0;    // 组提交次数
+    uint64_t writes = 0;     // 提交的WriteBatch数(单个put/remove也算一个)
+    uint64_t syncs = 0;
+    uint64_t compactedSegments = 0;
+    uint64_t cleanedKeys = 0;
+};
+
+struct RecoveryStats {
+    size_t segments = 0;
+    size_t records = 0;
+    size_t truncatedSegments = 0; // 末尾有损坏记录被丢弃的段
+    double seconds = 0;
+};
+
+// 一组写入，按顺序追加到binlog；组提交时和其他线程的WriteBatch合并落盘
+// 崩溃恢复得到的是binlog的一个前缀，一个WriteBatch可能只恢复了前半部分
+class WriteBatch {
+public:
+    void put(const Key &key, std::string_view value) {
+        size_t start = beginRecord();
+        _records.append(value);
+        finishRecord(start, RecordType::Put, key);
+    }
+
+    // 用反射生成的二进制编码直接编码到批次的缓冲区里
+    template <reflection::binary::Options Opt = reflection::binary::kFixed, reflection::Reflectable T>
+    void put(const Key &key, const T &value) {
+        size_t start = beginRecord();
+        reflection::binary::encode<Opt>(value, _records);
+        finishRecord(start, RecordType::Put, key);
+    }
+
+    void remove(const Key &key) { finishRecord(beginRecord(), RecordType::Remove, key); }
+
+    void clear() {
+        _records.clear();
+        _count = 0;
+        _maxRecord = 0;
+    }
+
+    bool empty() const { return _count == 0; }
+    size_t count() const { return _count; }
+    size_t bytes() const { return _records.size(); }
+
+private:
+    friend class Database;
+
+    size_t beginRecord() {
+        size_t start = _records.size();
+        RecordHeader placeholder{};
+        _records.append(&placeholder, sizeof(placeholder));
+        return start;
+    }
+
+    void finishRecord(size_t start, RecordType type, const Key &key) {
+        size_t size = _records.size() - start - sizeof(RecordHeader);
+        size_t padding = recordLength(static_cast<uint32_t>(size)) - sizeof(RecordHeader) - size;
+        static constexpr char zeros[8] = {};
+        _records.append(zeros, padding);
+        RecordHeader header{};
+        header.type = type;
+        header.size = static_cast<uint32_t>(size);
+        header.time = currentTime();
+        header.key = key;
+        char *record = _records.data() + start;
+        std::memcpy(record, &header, sizeof(header));
+        header.checksum = recordChecksum(record, header.size);
+        std::memcpy(record, &header.checksum, sizeof(header.checksum));
+        _maxRecord = std::max(_maxRecord, size + sizeof(RecordHeader) + padding);
+        ++_count;
+    }
+
+    reflection::OutputBuffer _records;
+    size_t _count = 0;
+    size_t _maxRecord = 0;
+};
+
+class Database {
+public:
+    Database() = default;
+    Database(const Database &) = delete;
+    Database &operator=(const Database &) = delete;
+    ~Database() { close(); }
+
+    // 打开(不存在则创建)目录root，重放binlog重建索引
+    Error open(const std::filesystem::path &root, const Settings &settings = {}) {
+        close();
+        _root = root;
+        _settings = settings;
+        std::error_code ec;
+        std::filesystem::create_directories(root, ec);
+        _lockFd = ::open((root / "LOCK").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (_lockFd < 0) {
+            return Error::IO;
+        }
+        if (flock(_lockFd, LOCK_EX | LOCK_NB) != 0) {
+            ::close(_lockFd);
+            _lockFd = -1;
+            return Error::Locked;
+        }
+        if (Error error = recover(); error != Error::Ok) {
+            close();
+            return error;
+        }
+        _failed = false;
+        if (_settings.backgroundMaintenance) {
+            _maintenance = std::jthread([this](std::stop_token stop) { maintenanceLoop(stop); });
+        }
+        return Error::Ok;
+    }
+
+    void close() {
+        if (_maintenance.joinable()) {
+            _maintenance.request_stop();
+            _maintenanceCv.notify_all();
+            _maintenance.join();
+        }
+        if (!_segments.empty() && active() && !_failed && _settings.sync != SyncMode::None) {
+            active()->sync();
+        }
+        _segments.clear();
+        _usage.clear();
+        _index.clear();
+        _victim = nullptr;
+        _totalSize = 0;
+        if (_lockFd >= 0) {
+            ::close(_lockFd);
+            _lockFd = -1;
+        }
+    }
+
+    // ---- 写入 ----
+
+    Error put(const Key &key, std::string_view value) {
+        WriteBatch &batch = localBatch();
+        batch.put(key, value);
+        return write(batch);
+    }
+
+    template <reflection::binary::Options Opt = reflection::binary::kFixed, reflection::Reflectable T>
+    Error put(const Key &key, const T &value) {
+        WriteBatch &batch = localBatch();
+        batch.put<Opt>(key, value);
+        return write(batch);
+    }
+
+    Error remove(const Key &key) {
+        WriteBatch &batch = localBatch();
+        batch.remove(key);
+        return write(batch);
+    }
+
+    // 组提交: 写入者排队，队首的写入者当leader，带上后面排队的写入一起写盘
+    // leader写盘时不持有队列锁，新来的写入者继续排队，自然攒成下一批
+    Error write(WriteBatch &batch) {
+        if (batch.empty()) {
+            return Error::Ok;
+        }
+        if (batch._maxRecord > _settings.segmentSize - sizeof(SegmentHeader)) {
+            return Error::TooLarge;
+        }
+        PendingWrite self;
+        self.batch = &batch;
+        std::unique_lock<std::mutex> lock(_queueMutex);
+        _queue.push_back(&self);
+        while (!self.done && _queue.front() != &self) {
+            self.cv.wait(lock);
+        }
+        if (self.done) {
+            return self.result;
+        }
+
+        size_t bytes = 0;
+        _group.clear();
+        for (PendingWrite *w : _queue) {
+            if (!_group.empty() && bytes + w->batch->bytes() > _settings.maxBatchBytes) {
+                break;
+            }
+            _group.push_back(w->batch);
+            bytes += w->batch->bytes();
+        }
+        size_t groupSize = _group.size();
+        lock.unlock();
+
+        Error result;
+        {
+            std::lock_guard<std::mutex> logLock(_logMutex);
+            _chunks.clear();
+            for (WriteBatch *b : _group) {
+                _chunks.emplace_back(b->_records.data(), b->_records.size());
+            }
+            result = commitLocked(_chunks, _settings.sync == SyncMode::Batch);
+            ++_stats.batches;
+            _stats.writes += groupSize;
+        }
+
+        lock.lock();
+        for (size_t i = 0; i < groupSize; ++i) {
+            PendingWrite *w = _queue.front();
+            _queue.pop_front();
+            if (w != &self) {
+                w->result = result;
+                w->done = true;
+                w->cv.notify_one();
+            }
+        }
+        if (!_queue.empty()) {
+            _queue.front()->cv.notify_one();
+        }
+        return result;
+    }
+
+    // 立即落盘(SyncMode::Periodic/None下需要确定持久化时调用)
+    Error sync() {
+        std::lock_guard<std::mutex> logLock(_logMutex);
+        if (_failed) {
+            return Error::IO;
+        }
+        if (!active()->sync()) {
+            _failed = true;
+            return Error::IO;
+        }
+        ++_stats.syncs;
+        _dirty = false;
+        return Error::Ok;
+    }
+
+    // ---- 读取 ----
+
+    bool get(const Key &key, std::string &out) {
+        return read(key, [&](std::string_view value) {
+            out.assign(value);
+            return true;
+        });
+    }
+
+    std::optional<std::string> get(const Key &key) {
+        std::string value;
+        if (!get(key, value)) {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    // 直接从映射的段文件解码，不经过中间缓冲区
+    template <reflection::binary::Options Opt = reflection::binary::kFixed, reflection::Reflectable T>
+    bool get(const Key &key, T &out) {
+        return read(key, [&](std::string_view value) { return reflection::binary::decode<Opt>(value, out); });
+    }
+
+    template <reflection::Reflectable T, reflection::binary::Options Opt = reflection::binary::kFixed>
+    std::optional<T> get(const Key &key) {
+        T value{};
+        if (!get<Opt>(key, value)) {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    bool contains(const Key &key) {
+        std::shared_lock<std::shared_mutex> lock(_indexMutex);
+        return _index.find(key) != nullptr;
+    }
+
+    // ---- 后台维护，也可以在backgroundMaintenance为false时手动调用 ----
+
+    // 清理一片: 删除过期的键，总大小超限时按最近使用时间淘汰。返回是否做了事
+    bool cleanStep() {
+        if (_settings.totalTimeLimit == 0 && _settings.totalSizeLimit == 0) {
+            return false;
+        }
+        std::lock_guard<std::mutex> logLock(_logMutex);
+        if (_failed || _segments.empty()) {
+            return false;
+        }
+        uint32_t now = currentTime();
+        _cleanBatch.clear();
+        int64_t planned = _totalSize;
+        if (_settings.totalTimeLimit != 0 && now > _settings.totalTimeLimit) {
+            collectTimeStale(now - _settings.totalTimeLimit, planned);
+        }
+        if (_settings.totalSizeLimit != 0) {
+            collectSizeStale(planned);
+        }
+        _sampled.clear();
+        if (_cleanBatch.empty()) {
+            return false;
+        }
+        _chunks.assign(1, std::string_view(_cleanBatch._records.data(), _cleanBatch._records.size()));
+        commitLocked(_chunks, _settings.sync == SyncMode::Batch);
+        _stats.cleanedKeys += _cleanBatch.count();
+        return true;
+    }
+
+    // 压缩一片: 把垃圾占比高的已封口段中仍然有效的记录搬到当前段末尾，整段搬完后删除。返回是否做了事
+    bool compactStep() {
+        std::lock_guard<std::mutex> logLock(_logMutex);
+        if (_failed || _segments.empty()) {
+            return false;
+        }
+        if (!_victim) {
+            _victim = pickVictimLocked();
+            if (!_victim) {
+                return false;
+            }
+            _compactCursor = sizeof(SegmentHeader);
+        }
+        Segment *victim = _victim;
+        bool oldest = victim == firstSegment();
+        _chunks.clear();
+        uint32_t offset = _compactCursor;
+        for (size_t n = 0; offset < victim->end() && n < _settings.compactSliceRecords; ++n) {
+            const RecordHeader &h = victim->header(offset);
+            uint32_t length = recordLength(h.size);
+            bool live;
+            if (h.type == RecordType::Put) {
+                const Entry *e = _index.find(h.key);
+                live = e && e->segment == victim->id() && e->offset == offset;
+            } else {
+                // 删除记录要挡住更早的段里同一个键的旧值；键之后又被写入过，或者已经没有更早的段时可以丢掉
+                live = !oldest && !_index.find(h.key);
+            }
+            if (live) {
+                const char *record = victim->data() + offset;
+                if (!_chunks.empty() && _chunks.back().data() + _chunks.back().size() == record) {
+                    _chunks.back() = std::string_view(_chunks.back().data(), _chunks.back().size() + length);
+                } else {
+                    _chunks.emplace_back(record, length);
+                }
+            }
+            offset += length;
+        }
+        if (!_chunks.empty() && commitLocked(_chunks, false) != Error::Ok) {
+            return false;
+        }
+        _compactCursor = offset;
+        if (offset >= victim->end()) {
+            // 搬过去的记录落盘之后才能删掉原来的段
+            if (_settings.sync != SyncMode::None && !active()->sync()) {
+                _failed = true;
+                return false;
+            }
+            std::unique_lock<std::shared_mutex> indexLock(_indexMutex);
+            removeSegmentLocked(victim);
+            _victim = nullptr;
+            ++_stats.compactedSegments;
+        }
+        return true;
+    }
+
+    // 一直压缩到没有满足条件的段
+    void compactAll() {
+        while (compactStep()) {
+        }
+    }
+
+    Stats stats() {
+        std::lock_guard<std::mutex> logLock(_logMutex);
+        Stats s = _stats;
+        s.keys = _index.size();
+        s.totalSize = _totalSize;
+        for (const auto &segment : _segments) {
+            if (segment) {
+                s.diskSize += segment->end();
+                ++s.segments;
+            }
+        }
+        return s;
+    }
+
+    const RecoveryStats &recoveryStats() const { return _recovery; }
+
+private:
+    struct PendingWrite {
+        WriteBatch *batch = nullptr;
+        Error result = Error::Ok;
+        bool done = false;
+        std::condition_variable cv;
+    };
+
+    // 每个段里索引仍指向的写入记录的字节数，以及删除记录的字节数，决定压缩哪个段
+    struct SegmentUsage {
+        int64_t live = 0;
+        int64_t tombstones = 0;
+    };
+
+    static WriteBatch &localBatch() {
+        thread_local WriteBatch batch;
+        batch.clear();
+        return batch;
+    }
+
+    // 段按编号连续存放，压缩删除的段留空，队首的空位弹出
+    Segment *segmentAt(uint32_t id) { return _segments[id - _firstSegment].get(); }
+    SegmentUsage &usageOf(uint32_t id) { return _usage[id - _firstSegment]; }
+    Segment *active() { return _segments.back().get(); }
+    Segment *firstSegment() { return _segments.front().get(); }
+
+    template <typename F>
+    bool read(const Key &key, F &&consume) {
+        std::shared_lock<std::shared_mutex> lock(_indexMutex);
+        Entry *e = _index.find(key);
+        if (!e) {
+            return false;
+        }
+        const Segment *segment = segmentAt(e->segment);
+        if (_settings.verifyOnRead && !segment->verify(e->offset)) {
+            return false;
+        }
+        touch(*e);
+        return consume(std::string_view(segment->value(e->offset), e->size));
+    }
+
+    // 读取在共享锁下进行，多个读者可能同时更新同一个条目的时间，用atomic_ref；秒级精度，没变就不写，避免缓存行来回失效
+    static void touch(Entry &e) {
+        if (std::atomic_ref<uint32_t> time(e.time); time.load(std::memory_order_relaxed) != currentTime()) {
+            time.store(currentTime(), std::memory_order_relaxed);
+        }
+    }
+
+    static uint32_t entryTime(Entry &e) { return std::atomic_ref<uint32_t>(e.time).load(std::memory_order_relaxed); }
+
+    // 把若干段连续的完整记录追加到binlog并更新索引，调用方持有_logMutex
+    Error commitLocked(std::span<const std::string_view> chunks, bool syncAfter) {
+        if (_failed) {
+            return Error::IO;
+        }
+        _ops.clear();
+        _iov.clear();
+        size_t pendingBytes = 0;
+        Segment *segment = active();
+        uint32_t writeOffset = segment->end();
+        auto flush = [&]() {
+            if (_iov.empty()) {
+                return true;
+            }
+            bool ok = segment->append(_iov.data(), static_cast<int>(_iov.size()), pendingBytes);
+            _iov.clear();
+            pendingBytes = 0;
+            return ok;
+        };
+        for (std::string_view chunk : chunks) {
+            for (size_t pos = 0; pos < chunk.size();) {
+                RecordHeader h;
+                std::memcpy(&h, chunk.data() + pos, sizeof(h));
+                uint32_t length = recordLength(h.size);
+                if (writeOffset + length > segment->capacity()) {
+                    if (!flush() || !rotateLocked()) {
+                        _failed = true;
+                        return Error::IO;
+                    }
+                    segment = active();
+                    writeOffset = segment->end();
+                }
+                // 同一个chunk里连续的记录合并成一个iovec
+                const char *record = chunk.data() + pos;
+                if (!_iov.empty() && static_cast<const char *>(_iov.back().iov_base) + _iov.back().iov_len == record) {
+                    _iov.back().iov_len += length;
+                } else {
+                    if (_iov.size() == IOV_MAX && !flush()) {
+                        _failed = true;
+                        return Error::IO;
+                    }
+                    _iov.push_back(iovec{const_cast<char *>(record), length});
+                }
+                _ops.push_back(IndexOp{h.key, h.type, segment->id(), writeOffset, h.size, h.time});
+                pendingBytes += length;
+                writeOffset += length;
+                pos += length;
+            }
+        }
+        if (!flush()) {
+            _failed = true;
+            return Error::IO;
+        }
+        if (syncAfter) {
+            if (!active()->sync()) {
+                _failed = true;
+                return Error::IO;
+            }
+            ++_stats.syncs;
+        } else {
+            _dirty = true;
+        }
+        std::unique_lock<std::shared_mutex> indexLock(_indexMutex);
+        for (const IndexOp &op : _ops) {
+            applyLocked(op);
+        }
+        return Error::Ok;
+    }
+
+    struct IndexOp {
+        Key key;
+        RecordType type;
+        uint32_t segment;
+        uint32_t offset;
+        uint32_t size;
+        uint32_t time;
+    };
+
+    void applyLocked(const IndexOp &op) {
+        uint32_t length = recordLength(op.size);
+        if (op.type == RecordType::Put) {
+            bool inserted = false;
+            Entry *e = _index.insert(op.key, inserted);
+            uint32_t time = op.time;
+            if (!inserted) {
+                uint32_t oldLength = recordLength(e->size);
+                usageOf(e->segment).live -= oldLength;
+                _totalSize -= oldLength;
+                time = std::max(time, e->time); // 压缩搬动的记录保留最近的使用时间
+            }
+            *e = Entry{op.key, op.segment, op.offset, op.size, time};
+            _totalSize += length;
+            usageOf(op.segment).live += length;
+        } else {
+            Entry removed;
+            if (_index.erase(op.key, removed)) {
+                uint32_t oldLength = recordLength(removed.size);
+                usageOf(removed.segment).live -= oldLength;
+                _totalSize -= oldLength;
+            }
+            usageOf(op.segment).tombstones += length;
+        }
+    }
+
+    // 当前段写满，落盘后换一个新段
+    bool rotateLocked() {
+        Segment *current = active();
+        if (_settings.sync != SyncMode::None && !current->sync()) {
+            return false;
+        }
+        Error error = Error::Ok;
+        auto segment = Segment::create(_root, current->id() + 1, _settings.segmentSize, error);
+        if (!segment) {
+            return false;
+        }
+        if (_settings.sync != SyncMode::None) {
+            syncDirectory();
+        }
+        std::unique_lock<std::shared_mutex> indexLock(_indexMutex);
+        _segments.push_back(std::move(segment));
+        _usage.emplace_back();
+        return true;
+    }
+
+    void syncDirectory() {
+        int fd = ::open(_root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd >= 0) {
+            ::fsync(fd);
+            ::close(fd);
+        }
+    }
+
+    // 持有_logMutex和_indexMutex的写锁
+    void removeSegmentLocked(Segment *segment) {
+        segment->unlinkOnClose();
+        _segments[segment->id() - _firstSegment].reset();
+        while (!_segments.front()) {
+            _segments.pop_front();
+            _usage.pop_front();
+            ++_firstSegment;
+        }
+    }
+
+    // 从最老的段开始找第一个垃圾占比达到阈值的已封口段
+    Segment *pickVictimLocked() {
+        for (size_t i = 0; i + 1 < _segments.size(); ++i) {
+            Segment *segment = _segments[i].get();
+            if (!segment) {
+                continue;
+            }
+            int64_t total = segment->end() - static_cast<int64_t>(sizeof(SegmentHeader));
+            if (total <= 0) {
+                continue;
+            }
+            // 删除记录是否保留由compactStep逐条判断: 最老的段里的全部丢掉，算作垃圾；其他段里的通常要原样搬到
+            // 当前段，算作垃圾的话只有删除记录的段会被一遍遍搬来搬去
+            int64_t kept = _usage[i].live + (i == 0 ? 0 : _usage[i].tombstones);
+            double garbage = 1.0 - static_cast<double>(kept) / static_cast<double>(total);
+            if (garbage >= _settings.compactGarbageRatio) {
+                return segment;
+            }
+        }
+        return nullptr;
+    }
+
+    // 从上次停下的位置继续扫描索引，一片最多扫描staleRemoveChunk*16个槽位
+    void collectTimeStale(uint32_t expireBefore, int64_t &planned) {
+        for (size_t budget = _settings.staleRemoveChunk * 16; budget > 0 && _cleanBatch.count() < _settings.staleRemoveChunk;
+             --budget) {
+            IndexShard &shard = _index.shard(_cleanShard);
+            if (_cleanSlot >= shard.capacity()) {
+                _cleanSlot = 0;
+                _cleanShard = (_cleanShard + 1) % KeyIndex::kShards;
+                continue;
+            }
+            Entry &e = shard.slot(_cleanSlot++);
+            if (e.segment != 0 && entryTime(e) < expireBefore) {
+                _cleanBatch.remove(e.key);
+                _sampled.insert(e.key);
+                planned -= recordLength(e.size);
+            }
+        }
+    }
+
+    // 近似LRU(和Redis一样): 每次随机采样若干个条目，淘汰其中最久没用过的一个，直到预计的总大小低于上限
+    void collectSizeStale(int64_t &planned) {
+        constexpr int kSamples = 16;
+        size_t keys = _index.size();
+        for (size_t evicted = 0; planned > _settings.totalSizeLimit && _cleanBatch.count() < _settings.staleRemoveChunk
+                                 && evicted < keys;
+             ++evicted) {
+            Entry *oldest = nullptr;
+            for (int i = 0; i < kSamples; ++i) {
+                IndexShard &shard = _index.shard(_rng() % KeyIndex::kShards);
+                if (shard.size() == 0) {
+                    continue;
+                }
+                // 从随机位置往后找第一个非空槽
+                for (size_t slot = _rng() & (shard.capacity() - 1);; slot = (slot + 1) & (shard.capacity() - 1)) {
+                    Entry &e = shard.slot(slot);
+                    if (e.segment != 0) {
+                        if ((!oldest || entryTime(e) < entryTime(*oldest)) && !_sampled.contains(e.key)) {
+                            oldest = &e;
+                        }
+                        break;
+                    }
+                }
+            }
+            if (!oldest) {
+                break;
+            }
+            _sampled.insert(oldest->key);
+            _cleanBatch.remove(oldest->key);
+            planned -= recordLength(oldest->size);
+        }
+    }
+
+    void maintenanceLoop(std::stop_token stop) {
+        std::mutex mutex;
+        std::unique_lock<std::mutex> lock(mutex);
+        auto lastSync = std::chrono::steady_clock::now();
+        while (!stop.stop_requested()) {
+            bool busy = false;
+            if (_settings.sync == SyncMode::Periodic && std::chrono::steady_clock::now() - lastSync >= _settings.syncInterval) {
+                lastSync = std::chrono::steady_clock::now();
+                std::lock_guard<std::mutex> logLock(_logMutex);
+                if (_dirty && !_failed) {
+                    _failed = !active()->sync();
+                    _dirty = false;
+                    ++_stats.syncs;
+                }
+            }
+            busy |= cleanStep();
+            busy |= compactStep();
+            auto wait = busy ? _settings.sliceInterval : _settings.maintenanceInterval;
+            if (_settings.sync == SyncMode::Periodic) {
+                wait = std::min(wait, std::chrono::duration_cast<std::chrono::milliseconds>(_settings.syncInterval));
+            }
+            _maintenanceCv.wait_for(lock, stop, wait, [] { return false; });
+        }
+    }
+
+    // ---- 恢复 ----
+
+    struct RecordRef {
+        Key key;
+        uint32_t offset;
+        uint32_t size;
+        uint32_t time;
+        RecordType type;
+    };
+
+    // 出错时清空段表再返回: 段表里可能还留着没打开的空位，close()不能把它们当成段
+    Error recover() {
+        Error error = recoverSegments();
+        if (error != Error::Ok) {
+            _segments.clear();
+            _usage.clear();
+            _index.clear();
+            _totalSize = 0;
+        }
+        return error;
+    }
+
+    Error recoverSegments() {
+        auto start = std::chrono::steady_clock::now();
+        _recovery = RecoveryStats{};
+        _stats = Stats{};
+        std::vector<uint32_t> ids;
+        for (const auto &item : std::filesystem::directory_iterator(_root)) {
+            const std::string name = item.path().filename().string();
+            unsigned id = 0;
+            char tail = 0;
+            if (std::sscanf(name.c_str(), "%u.binlo%c", &id, &tail) == 2 && tail == 'g' && id > 0) {
+                ids.push_back(id);
+            }
+        }
+        std::sort(ids.begin(), ids.end());
+
+        Error error = Error::Ok;
+        _segments.clear();
+        _usage.clear();
+        if (ids.empty()) {
+            _firstSegment = 1;
+            auto segment = Segment::create(_root, 1, _settings.segmentSize, error);
+            if (!segment) {
+                return error;
+            }
+            syncDirectory();
+            _segments.push_back(std::move(segment));
+            _usage.emplace_back();
+            return Error::Ok;
+        }
+        // 压缩删掉的段在中间留下的空缺
+        _firstSegment = ids.front();
+        _segments.resize(ids.back() - ids.front() + 1);
+        _usage.resize(_segments.size());
+        for (uint32_t id : ids) {
+            auto segment = Segment::open(segmentPath(_root, id), id, error);
+            if (!segment) {
+                return error;
+            }
+            _segments[id - _firstSegment] = std::move(segment);
+        }
+        while (!_segments.back()) {
+            _segments.pop_back();
+            _usage.pop_back();
+        }
+
+        // 第一阶段: 各段并行校验，每条记录按分片分到threads个桶里
+        unsigned threads = _settings.recoveryThreads ? _settings.recoveryThreads : std::thread::hardware_concurrency();
+        threads = std::clamp<unsigned>(threads, 1, KeyIndex::kShards);
+        size_t segmentCount = _segments.size();
+        std::vector<std::vector<std::vector<RecordRef>>> buckets(segmentCount, std::vector<std::vector<RecordRef>>(threads));
+        std::vector<uint32_t> ends(segmentCount, 0);
+        std::atomic<size_t> nextSegment{0};
+        std::atomic<size_t> records{0};
+        runThreads(threads, [&](unsigned) {
+            for (size_t i = nextSegment.fetch_add(1); i < segmentCount; i = nextSegment.fetch_add(1)) {
+                Segment *segment = _segments[i].get();
+                if (!segment) {
+                    continue;
+                }
+                size_t count = 0;
+                ends[i] = segment->scan([&](const RecordHeader &h, uint32_t offset) {
+                    size_t group = KeyIndex::shardOf(hashKey(h.key)) % threads;
+                    buckets[i][group].push_back(RecordRef{h.key, offset, h.size, h.time, h.type});
+                    ++count;
+                });
+                records.fetch_add(count, std::memory_order_relaxed);
+            }
+        });
+        _recovery.records = records.load();
+
+        // 第二阶段: 线程t负责分片号模threads等于t的分片，按段的顺序重放，后面的记录覆盖前面的
+        std::vector<std::vector<SegmentUsage>> usages(threads, std::vector<SegmentUsage>(segmentCount));
+        std::vector<int64_t> totals(threads, 0);
+        runThreads(threads, [&](unsigned t) {
+            std::vector<SegmentUsage> &usage = usages[t];
+            for (size_t i = 0; i < segmentCount; ++i) {
+                uint32_t id = _firstSegment + static_cast<uint32_t>(i);
+                for (const RecordRef &r : buckets[i][t]) {
+                    uint32_t length = recordLength(r.size);
+                    if (r.type == RecordType::Put) {
+                        bool inserted = false;
+                        Entry *e = _index.insert(r.key, inserted);
+                        if (!inserted) {
+                            usage[e->segment - _firstSegment].live -= recordLength(e->size);
+                            totals[t] -= recordLength(e->size);
+                        }
+                        *e = Entry{r.key, id, r.offset, r.size, r.time};
+                        totals[t] += length;
+                        usage[i].live += length;
+                    } else {
+                        Entry removed;
+                        if (_index.erase(r.key, removed)) {
+                            usage[removed.segment - _firstSegment].live -= recordLength(removed.size);
+                            totals[t] -= recordLength(removed.size);
+                        }
+                        usage[i].tombstones += length;
+                    }
+                }
+                std::vector<RecordRef>().swap(buckets[i][t]);
+            }
+        });
+
+        for (size_t i = 0; i < segmentCount; ++i) {
+            if (!_segments[i]) {
+                continue;
+            }
+            ++_recovery.segments;
+            _segments[i]->setEnd(ends[i]);
+            for (unsigned t = 0; t < threads; ++t) {
+                _usage[i].live += usages[t][i].live;
+                _usage[i].tombstones += usages[t][i].tombstones;
+            }
+            // 有效数据之后还有非0字节说明末尾的记录损坏
+            if (ends[i] + sizeof(RecordHeader) <= _segments[i]->capacity()) {
+                const RecordHeader &h = _segments[i]->header(ends[i]);
+                if (static_cast<uint8_t>(h.type) != 0 || h.size != 0 || h.checksum != 0) {
+                    ++_recovery.truncatedSegments;
+                }
+            }
+        }
+        for (unsigned t = 0; t < threads; ++t) {
+            _totalSize += totals[t];
+        }
+        if (!active()->zeroTail()) {
+            return Error::IO;
+        }
+        _recovery.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return Error::Ok;
+    }
+
+    template <typename F>
+    static void runThreads(unsigned n, F &&f) {
+        if (n == 1) {
+            f(0u);
+            return;
+        }
+        std::vector<std::jthread> threads;
+        threads.reserve(n);
+        for (unsigned t = 0; t < n; ++t) {
+            threads.emplace_back([&f, t] { f(t); });
+        }
+    }
+
+    std::filesystem::path _root;
+    Settings _settings;
+    int _lockFd = -1;
+
+    // 读者持有共享锁；修改索引和段表时持有写锁(只在_logMutex之内短暂持有)
+    std::shared_mutex _indexMutex;
+    KeyIndex _index;
+    std::deque<std::unique_ptr<Segment>> _segments;
+    uint32_t _firstSegment = 1;
+
+    // binlog的写权限: 组提交的leader、清理器和压缩器轮流持有
+    std::mutex _logMutex;
+    std::deque<SegmentUsage> _usage;
+    int64_t _totalSize = 0;
+    bool _failed = false;
+    bool _dirty = false;
+    Stats _stats;
+    RecoveryStats _recovery;
+    std::vector<iovec> _iov;
+    std::vector<IndexOp> _ops;
+    std::vector<std::string_view> _chunks;
+
+    // 组提交队列
+    std::mutex _queueMutex;
+    std::deque<PendingWrite *> _queue;
+    std::vector<WriteBatch *> _group;
+
+    // 清理器和压缩器的进度
+    WriteBatch _cleanBatch;
+    size_t _cleanShard = 0;
+    size_t _cleanSlot = 0;
+    struct KeyHash {
+        size_t operator()(const Key &key) const { return hashKey(key); }
+    };
+    std::unordered_set<Key, KeyHash> _sampled;
+    std::minstd_rand _rng{12345};
+    Segment *_victim = nullptr;
+    uint32_t _compactCursor = 0;
+
+    std::condition_variable_any _maintenanceCv;
+    std::jthread _maintenance;
+};
+
+} // namespace kv
+
+#endif // KV_STORE_HPP_
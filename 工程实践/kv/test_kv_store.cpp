@@ -0,0 +1,112 @@
+// kv存储的测试: 打开、恢复、损坏的段文件、删除记录的压缩
+// g++ -std=c++20 -O2 -pthread test_kv_store.cpp -o test_kv_store
+// ./test_kv_store [dir=./kv_test_data]
+#include "kv_store.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                                                                    \
+    do {                                                                                                               \
+        if (!(cond)) {                                                                                                 \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);                              \
+            ++failures;                                                                                                \
+        }                                                                                                              \
+    } while (0)
+
+static void writeFile(const std::filesystem::path &path, const std::string &content) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << content;
+}
+
+static kv::Settings smallSegments() {
+    kv::Settings settings;
+    settings.segmentSize = 64 * 1024;
+    settings.backgroundMaintenance = false;
+    return settings;
+}
+
+// 写入、删除后重新打开，数据保持不变
+static void testReopen(const std::filesystem::path &dir) {
+    std::filesystem::remove_all(dir);
+    {
+        kv::Database db;
+        CHECK(db.open(dir, smallSegments()) == kv::Error::Ok);
+        for (uint64_t i = 0; i < 5000; ++i) {
+            CHECK(db.put(kv::keyFromTypeAndId(1, i), std::to_string(i)) == kv::Error::Ok);
+        }
+        for (uint64_t i = 0; i < 5000; i += 3) {
+            CHECK(db.remove(kv::keyFromTypeAndId(1, i)) == kv::Error::Ok);
+        }
+    }
+    kv::Database db;
+    CHECK(db.open(dir, smallSegments()) == kv::Error::Ok);
+    for (uint64_t i = 0; i < 5000; ++i) {
+        auto value = db.get(kv::keyFromTypeAndId(1, i));
+        CHECK(i % 3 == 0 ? !value : value && *value == std::to_string(i));
+    }
+}
+
+// 垃圾内容或比段头还短的段文件: open返回Corrupted而不是崩溃，之后目录修好还能正常打开
+static void testCorruptedSegment(const std::filesystem::path &dir) {
+    const std::string contents[] = {std::string(4096, '\x5a'), std::string(8, '\0'), std::string()};
+    for (const std::string &content : contents) {
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+        writeFile(kv::segmentPath(dir, 1), content);
+        kv::Database db;
+        CHECK(db.open(dir, smallSegments()) == kv::Error::Corrupted);
+        db.close();
+        std::filesystem::remove(kv::segmentPath(dir, 1));
+        CHECK(db.open(dir, smallSegments()) == kv::Error::Ok);
+        CHECK(db.put(kv::keyFromString("k"), "v") == kv::Error::Ok);
+    }
+
+    // 已有数据之后多出一个截断的段
+    std::filesystem::remove_all(dir);
+    {
+        kv::Database db;
+        CHECK(db.open(dir, smallSegments()) == kv::Error::Ok);
+        CHECK(db.put(kv::keyFromString("k"), "v") == kv::Error::Ok);
+    }
+    writeFile(kv::segmentPath(dir, 3), std::string(16, '\0'));
+    kv::Database db;
+    CHECK(db.open(dir, smallSegments()) == kv::Error::Corrupted);
+}
+
+// 只剩删除记录的段也要被压缩掉
+static void testTombstoneCompaction(const std::filesystem::path &dir) {
+    std::filesystem::remove_all(dir);
+    kv::Database db;
+    CHECK(db.open(dir, smallSegments()) == kv::Error::Ok);
+    for (int round = 0; round < 50; ++round) {
+        for (uint64_t i = 0; i < 2000; ++i) {
+            CHECK(db.put(kv::keyFromTypeAndId(1, i), std::to_string(round)) == kv::Error::Ok);
+        }
+        for (uint64_t i = 0; i < 2000; ++i) {
+            CHECK(db.remove(kv::keyFromTypeAndId(1, i)) == kv::Error::Ok);
+        }
+    }
+    db.compactAll();
+    kv::Stats s = db.stats();
+    CHECK(s.keys == 0);
+    CHECK(s.segments <= 2);
+}
+
+int main(int argc, char **argv) {
+    std::filesystem::path dir = argc > 1 ? argv[1] : "kv_test_data";
+    testReopen(dir);
+    testCorruptedSegment(dir);
+    testTombstoneCompaction(dir);
+    std::filesystem::remove_all(dir);
+    if (failures) {
+        std::fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("all tests passed\n");
+    return 0;
+}